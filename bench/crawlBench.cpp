@@ -0,0 +1,476 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  Offline Crawl Throughput Benchmark
+ * ----------------------------------------------------------------------------
+ *  Serves a synthetic web graph from a local mock HTTP server and crawls it
+ *  with the real crawl path: ClientSocket page tasks on the work-stealing
+ *  ThreadPool, scheduled by the crawler's own PageScheduler, plus a
+ *  single-site ClientSocket::startDiscovering() baseline. No real site is contacted: the
+ *  graph's hosts (site0.com, site1.com, ...) are pinned to 127.0.0.1 in the
+ *  DnsCache.
+ *
+ *  Every site has the same pages. Page i links to pages i*fanout+1 ..
+ *  i*fanout+fanout of its site and to `external` other sites; the root page
+ *  links to every site. The crawl starts from all sites at once (or from
+ *  the first --seeds of them), so their pages compete for the workers from
+ *  the start, as on a crawl with many start URLs.
+ *
+ *  Usage: crawlBench [options]
+ *    --sites N        Sites in the graph (default 8)
+ *    --pages N        Pages per site (default 200)
+ *    --fanout N       Internal links per page (default 4)
+ *    --external N     Links to other sites per page (default 2)
+ *    --page-size N    Body bytes per page (default 16384)
+ *    --latency N      Server delay before each response in ms (default 0)
+ *    --close          Server closes the connection after every response
+ *    --seeds N        Sites the crawl starts from (default all)
+ *    --pipeline N     pipelineDepth (and hostBurst) of every site (default 1)
+ *    --threads a,b,.. maxThreads values to run (default 1,4,16)
+ *    --delays a,b,..  crawlDelay values in ms to run (default 0,10)
+ *  Prints pages/sec, bytes/sec (on the wire), crawler CPU seconds (server
+ *  threads excluded) and the process's peak RSS after each run.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "../clientSocket.h"
+#include "../dnsCache.h"
+#include "../threadPool.h"
+#include "../pageScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+struct GraphOptions {
+    int sites = 8;
+    int pages = 200;
+    int fanout = 4;
+    int external = 2;
+    size_t pageSize = 16384;
+    int latencyMs = 0;
+    bool keepAlive = true;
+    int seeds = -1;                  // Start sites; -1 for every site
+    int pipelineDepth = 1;
+};
+
+#ifdef _WIN32
+
+double fileTimeSeconds(const FILETIME& time) {
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return value.QuadPart / 1e7;
+}
+
+double processCpuSeconds() {
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    return fileTimeSeconds(kernel) + fileTimeSeconds(user);
+}
+
+double threadCpuSeconds() {
+    FILETIME created, exited, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user);
+    return fileTimeSeconds(kernel) + fileTimeSeconds(user);
+}
+
+size_t peakRssBytes() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+}
+
+#else
+
+double timeValSeconds(const struct timeval& time) {
+    return time.tv_sec + time.tv_usec / 1e6;
+}
+
+double processCpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return timeValSeconds(usage.ru_utime) + timeValSeconds(usage.ru_stime);
+}
+
+double threadCpuSeconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// ru_maxrss is in KB on Linux (bytes on macOS)
+size_t peakRssBytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+#endif
+
+string siteName(int index) {
+    return "site" + to_string(index) + ".com";
+}
+
+// ----------------------------------------------------------------------------
+// Mock server: one thread per connection, pages generated from the request
+// ----------------------------------------------------------------------------
+class MockServer {
+public:
+    explicit MockServer(const GraphOptions& options)
+        : options(options), listener(INVALID_SOCKET), port(0), active(0), cpuMicros(0) {}
+
+    ~MockServer() { stop(); }
+
+    // Listens on an ephemeral loopback port; returns false when it cannot
+    bool start() {
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == INVALID_SOCKET) return false;
+
+        SOCKADDR_IN address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if (::bind(listener, (SOCKADDR*)&address, sizeof(address)) == SOCKET_ERROR ||
+            listen(listener, SOMAXCONN) == SOCKET_ERROR ||
+            getsockname(listener, (SOCKADDR*)&address, &length) == SOCKET_ERROR) {
+            closeSocket(listener);
+            listener = INVALID_SOCKET;
+            return false;
+        }
+        port = ntohs(address.sin_port);
+        acceptor = thread(&MockServer::acceptLoop, this);
+        return true;
+    }
+
+    void stop() {
+        if (listener == INVALID_SOCKET) return;
+        SOCKET closing = listener;
+        listener = INVALID_SOCKET;
+        shutdown(closing, SD_BOTH);
+        closeSocket(closing);
+        if (acceptor.joinable()) acceptor.join();
+
+        {
+            lock_guard<mutex> lock(connectionMutex);
+            for (SOCKET client : clients) shutdown(client, SD_BOTH);
+        }
+        for (thread& worker : workers) worker.join();
+        workers.clear();
+    }
+
+    // Waits (up to a second) until the crawler closed every connection, so
+    // the CPU time of their threads has been counted
+    void settle() {
+        auto giveUp = steady_clock::now() + seconds(1);
+        while (active.load() > 0 && steady_clock::now() < giveUp) this_thread::sleep_for(milliseconds(1));
+    }
+
+    int listenPort() const { return port; }
+    double cpuSeconds() const { return cpuMicros.load() / 1e6; }
+
+private:
+    GraphOptions options;
+    SOCKET listener;
+    int port;
+    thread acceptor;
+    mutex connectionMutex;           // Guards clients and workers
+    vector<SOCKET> clients;
+    vector<thread> workers;
+    atomic<int> active;              // Connections still open
+    atomic<uint64_t> cpuMicros;      // CPU time of finished connection threads
+
+    void acceptLoop() {
+        while (true) {
+            SOCKET client = accept(listener, NULL, NULL);
+            if (client == INVALID_SOCKET) return;
+            active++;
+            lock_guard<mutex> lock(connectionMutex);
+            clients.push_back(client);
+            workers.emplace_back(&MockServer::serve, this, client);
+        }
+    }
+
+    void serve(SOCKET client) {
+        string pending;
+        char buffer[4096];
+        bool open = true;
+
+        while (open) {
+            size_t end;
+            while ((end = pending.find("\r\n\r\n")) == string::npos) {
+                int received = recv(client, buffer, sizeof(buffer), 0);
+                if (received <= 0) {
+                    open = false;
+                    break;
+                }
+                pending.append(buffer, received);
+            }
+            if (!open) break;
+
+            string request = pending.substr(0, end);
+            pending.erase(0, end + 4);
+            if (options.latencyMs > 0) this_thread::sleep_for(milliseconds(options.latencyMs));
+
+            string response = respond(request);
+            if (send(client, response.data(), (int)response.size(), 0) != (int)response.size()) break;
+            if (!options.keepAlive) break;
+        }
+
+        {
+            lock_guard<mutex> lock(connectionMutex);
+            clients.erase(find(clients.begin(), clients.end(), client));
+        }
+        closeSocket(client);
+        cpuMicros += (uint64_t)(threadCpuSeconds() * 1e6);
+        active--;
+    }
+
+    string respond(const string& request) {
+        size_t pathStart = request.find(' ') + 1;
+        string path = request.substr(pathStart, request.find(' ', pathStart) - pathStart);
+
+        int site = 0;
+        size_t host = request.find("\r\nHost: site");
+        if (host != string::npos) site = atoi(request.c_str() + host + 12);
+
+        int page = path.compare(0, 3, "/p/") == 0 ? atoi(path.c_str() + 3) : 0;
+        string body = page < options.pages ? pageBody(site, page) : string();
+        string status = page < options.pages ? "200 OK" : "404 Not Found";
+
+        return "HTTP/1.1 " + status + "\r\n"
+               "Content-Type: text/html\r\n"
+               "Content-Length: " + to_string(body.size()) + "\r\n" +
+               (options.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n") + body;
+    }
+
+    string pageBody(int site, int page) {
+        string body = "<html><head><title>" + siteName(site) + " page " + to_string(page) + "</title></head><body>\n";
+        // Absolute URLs: the link extractor does not resolve relative ones
+        for (int k = 1; k <= options.fanout; k++) {
+            int child = page * options.fanout + k;
+            if (child >= options.pages) break;
+            body += "<a href=\"http://" + siteName(site) + "/p/" + to_string(child) + "\">page " + to_string(child) + "</a>\n";
+        }
+        // The root links every site, so the graph is one level of sites
+        // deep rather than a tree whose leaves wait for their parent site
+        for (int other = 0; page == 0 && other < options.sites; other++) {
+            if (other != site) body += "<a href=\"http://" + siteName(other) + "/\">" + siteName(other) + "</a>\n";
+        }
+        for (int k = 1; k <= options.external && options.sites > 1 && page > 0; k++) {
+            int other = (site * options.external + k) % options.sites;
+            if (other != site) body += "<a href=\"http://" + siteName(other) + "/\">" + siteName(other) + "</a>\n";
+        }
+
+        static const string filler = "<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+                                     "tempor incididunt ut labore et dolore magna aliqua.</p>\n";
+        while (body.size() + filler.size() + 15 <= options.pageSize) body += filler;
+        return body + "</body></html>\n";
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Crawl driver: scheduleCrawlers() on the crawler's own PageScheduler
+// ----------------------------------------------------------------------------
+struct RunResult {
+    size_t pages = 0;
+    size_t bytes = 0;
+};
+
+class BenchCrawl {
+public:
+    BenchCrawl(const GraphOptions& options, int threads, int crawlDelay, int port)
+        : options(options), pool(threads), crawlDelay(crawlDelay), port(port),
+          scheduler(pool, 0, [this](ClientSocket& site, int) { finish(site); }) {}
+
+    RunResult run() {
+        for (int i = 0; i < options.seeds; i++) {
+            string hostname = siteName(i);
+            seen.insert(hostname);
+            pool.submit([this, hostname] { startSite(hostname); });
+        }
+        pool.waitIdle();
+        return result;
+    }
+
+private:
+    GraphOptions options;
+    ThreadPool pool;
+    int crawlDelay;
+    int port;
+    PageScheduler scheduler;
+    mutex resultMutex;               // Guards seen and result
+    unordered_set<string> seen;
+    RunResult result;
+
+    // As createSite() builds it, with the burst that lets pipelined batches form
+    void startSite(const string& hostname) {
+        scheduler.start(unique_ptr<ClientSocket>(new ClientSocket(hostname, port, -1, crawlDelay, true, 1,
+                                                                  options.pipelineDepth, 1 << 20,
+                                                                  options.pipelineDepth)), 0);
+    }
+
+    // finishCrawl() without the crawler's global state
+    void finish(ClientSocket& site) {
+        site.finishSite();
+        SiteStats stats = site.takeStats();
+
+        vector<string> linked;
+        {
+            lock_guard<mutex> lock(resultMutex);
+            result.pages += stats.visitedPages.size();
+            result.bytes += stats.bytesOnWire;
+            for (const UrlRecord& record : stats.linkedSites) {
+                string hostname(stats.linkedSites.host(record));
+                if (seen.insert(hostname).second) linked.push_back(hostname);
+            }
+        }
+        for (const string& hostname : linked) {
+            pool.submit([this, hostname] { startSite(hostname); });
+        }
+    }
+};
+
+vector<int> parseList(const char* text) {
+    vector<int> values;
+    stringstream list(text);
+    string item;
+    while (getline(list, item, ',')) values.push_back(atoi(item.c_str()));
+    return values;
+}
+
+void printRow(const string& label, int crawlDelay, const RunResult& result, double seconds, double cpu) {
+    cout << left << setw(22) << label << right
+         << setw(8) << crawlDelay
+         << setw(8) << result.pages
+         << setw(12) << fixed << setprecision(1) << result.pages / seconds
+         << setw(12) << setprecision(2) << result.bytes / seconds / (1024 * 1024)
+         << setw(10) << setprecision(3) << cpu
+         << setw(10) << peakRssBytes() / (1024 * 1024) << "\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    GraphOptions options;
+    vector<int> threadCounts = {1, 4, 16};
+    vector<int> delays = {0, 10};
+
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+        if (option == "--close") { options.keepAlive = false; continue; }
+        if (option == "--sites") options.sites = max(1, atoi(value));
+        else if (option == "--pages") options.pages = max(1, atoi(value));
+        else if (option == "--fanout") options.fanout = max(1, atoi(value));
+        else if (option == "--external") options.external = max(0, atoi(value));
+        else if (option == "--seeds") options.seeds = max(1, atoi(value));
+        else if (option == "--pipeline") options.pipelineDepth = max(1, atoi(value));
+        else if (option == "--page-size") options.pageSize = (size_t)max(0, atoi(value));
+        else if (option == "--latency") options.latencyMs = max(0, atoi(value));
+        else if (option == "--threads") threadCounts = parseList(value);
+        else if (option == "--delays") delays = parseList(value);
+        else {
+            cerr << "Unknown option " << option << "\n";
+            return 1;
+        }
+        i++;
+    }
+    if (options.seeds < 0 || options.seeds > options.sites) options.seeds = options.sites;
+
+    try {
+        initNetwork();
+    }
+    catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    MockServer server(options);
+    if (!server.start()) {
+        cerr << "Cannot start the mock server\n";
+        return 1;
+    }
+
+    SOCKADDR_IN loopback;
+    memset(&loopback, 0, sizeof(loopback));
+    loopback.sin_family = AF_INET;
+    loopback.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < options.sites; i++) DnsCache::shared().pin(siteName(i), loopback);
+
+    cout << "Graph: " << options.sites << " sites x " << options.pages << " pages, fan-out " << options.fanout
+         << ", " << options.external << " external links, " << options.pageSize << " B pages, "
+         << options.latencyMs << " ms latency, " << (options.keepAlive ? "keep-alive" : "close") << ", "
+         << options.seeds << " seeds, pipeline depth " << options.pipelineDepth << "\n\n";
+    cout << left << setw(22) << "driver" << right << setw(8) << "delay" << setw(8) << "pages"
+         << setw(12) << "pages/s" << setw(12) << "MB/s" << setw(10) << "CPU s" << setw(10) << "RSS MB" << "\n";
+
+    for (int crawlDelay : delays) {
+        // One site on the calling thread through ClientSocket alone
+        {
+            double cpuStart = processCpuSeconds(), serverStart = server.cpuSeconds();
+            auto start = steady_clock::now();
+            SiteStats stats;
+            {
+                ClientSocket site(siteName(0), server.listenPort(), -1, crawlDelay, true, 1, options.pipelineDepth, 1 << 20,
+                                  options.pipelineDepth);
+                stats = site.startDiscovering();
+            }
+            server.settle();
+            double elapsed = duration<double>(steady_clock::now() - start).count();
+            RunResult result;
+            result.pages = stats.visitedPages.size();
+            result.bytes = stats.bytesOnWire;
+            printRow("startDiscovering", crawlDelay, result, elapsed,
+                     processCpuSeconds() - cpuStart - (server.cpuSeconds() - serverStart));
+        }
+
+        for (int threads : threadCounts) {
+            if (threads <= 0) continue;
+            double cpuStart = processCpuSeconds(), serverStart = server.cpuSeconds();
+            auto start = steady_clock::now();
+            RunResult result;
+            {
+                BenchCrawl crawl(options, threads, crawlDelay, server.listenPort());
+                result = crawl.run();
+            }
+            server.settle();
+            double elapsed = duration<double>(steady_clock::now() - start).count();
+            printRow("pool, " + to_string(threads) + " threads", crawlDelay, result, elapsed,
+                     processCpuSeconds() - cpuStart - (server.cpuSeconds() - serverStart));
+        }
+    }
+
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  Link Extraction Micro-Benchmark
+ * ----------------------------------------------------------------------------
+ *  Compares the single-pass extractUrls (table lookup + SIMD skip-ahead)
+ *  with the previous implementation (std::map filtered copy followed by four
+ *  find loops), kept here verbatim as the baseline. Both must produce the
+ *  same set of links.
+ *
+ *  Usage: extractBench [page.html ...]
+ *  Without arguments a synthetic, link-dense page is generated.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "../parser.h"
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace legacy {
+
+string reformatHttpResponse(const string& text) {
+    static const string allowedChrs = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789.,/\":#?+-_= ";
+    static const map<char, char> charMap = []() {
+        map<char, char> m;
+        for (char ch : allowedChrs) m[ch] = ch;
+        m['\n'] = ' ';
+        return m;
+    }();
+
+    string result;
+    result.reserve(text.length());
+    for (char ch : text) {
+        auto it = charMap.find(ch);
+        if (it != charMap.end()) {
+            result += tolower(it->second);
+        }
+    }
+    return result;
+}
+
+LinkedList extractUrls(const string& httpText) {
+    string httpRaw = reformatHttpResponse(httpText);
+    static const array<string, 4> urlStart = {"href=\"", "href = \"", "http://", "https://"};
+    static const string urlEndChars = "\"#?, ";
+    LinkedList extractedUrls;
+
+    for (const auto& startText : urlStart) {
+        size_t pos = 0;
+        while ((pos = httpRaw.find(startText, pos)) != string::npos) {
+            pos += startText.length();
+            size_t endPos = httpRaw.find_first_of(urlEndChars, pos);
+            if (endPos == string::npos) break;
+
+            string url = httpRaw.substr(pos, endPos - pos);
+            if (verifyUrl(url)) {
+                extractedUrls.emplace(getHostnameFromUrl(url), getHostPathFromUrl(url));
+            }
+            pos = endPos;
+        }
+    }
+    return extractedUrls;
+}
+
+}
+
+namespace {
+
+string syntheticPage() {
+    stringstream ss;
+    ss << "<!DOCTYPE html><html><head><title>Synthetic</title>"
+       << "<link rel=\"stylesheet\" href=\"http://cdn.example.com/site.css\"></head><body>\n";
+    for (int i = 0; i < 5000; i++) {
+        ss << "<div class=\"item\"><p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+           << "eiusmod tempor incididunt ut labore et dolore magna aliqua.</p>"
+           << "<a href=\"http://www.site" << (i % 97) << ".com/page/" << i << "?ref=list\">Item " << i << "</a> "
+           << "<a HREF = \"https://Shop" << (i % 13) << ".pk/items/" << i << "#top\">Shop</a>"
+           << "<img src=\"http://img.example.com/" << i << ".png\"></div>\n";
+    }
+    ss << "</body></html>\n";
+    return ss.str();
+}
+
+set<pair<string, string>> linkSet(const LinkedList& links) {
+    set<pair<string, string>> result;
+    for (Node* node = links.getHead(); node; node = node->next) {
+        result.insert(make_pair(node->url, node->metadata));
+    }
+    return result;
+}
+
+set<pair<string, string>> linkSet(const UrlList& links) {
+    set<pair<string, string>> result;
+    for (const UrlRecord& link : links) {
+        result.insert(make_pair(string(links.host(link)), string(links.path(link))));
+    }
+    return result;
+}
+
+// Runs fn until at least 0.5 s passed and returns nanoseconds per byte
+template<typename Fn>
+double timePerByte(const string& page, Fn fn, size_t& linkCount) {
+    size_t iterations = 0;
+    auto start = steady_clock::now();
+    auto elapsed = steady_clock::duration::zero();
+    do {
+        auto links = fn(page);
+        linkCount = links.size();
+        iterations++;
+        elapsed = steady_clock::now() - start;
+    } while (elapsed < milliseconds(500));
+
+    return duration<double, nano>(elapsed).count() / (double(iterations) * page.size());
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    vector<pair<string, string>> pages;
+    for (int i = 1; i < argc; i++) {
+        ifstream file(argv[i], ios::binary);
+        if (!file) {
+            cerr << "Cannot open " << argv[i] << endl;
+            return 1;
+        }
+        stringstream content;
+        content << file.rdbuf();
+        pages.push_back(make_pair(string(argv[i]), content.str()));
+    }
+    if (pages.empty()) pages.push_back(make_pair(string("synthetic"), syntheticPage()));
+
+    cout << fixed << setprecision(3);
+    cout << "Page\tBytes\tLinks\tLegacy ns/B\tSingle-pass ns/B\tSpeed-up\n";
+
+    int mismatches = 0;
+    for (const auto& page : pages) {
+        if (linkSet(legacy::extractUrls(page.second)) != linkSet(extractUrls(page.second))) {
+            cerr << "Link sets differ for " << page.first << endl;
+            mismatches++;
+        }
+
+        size_t legacyLinks = 0, links = 0;
+        double legacyTime = timePerByte(page.second, legacy::extractUrls, legacyLinks);
+        double newTime = timePerByte(page.second, extractUrls, links);
+
+        cout << page.first << "\t" << page.second.size() << "\t" << links << "\t"
+             << legacyTime << "\t" << newTime << "\t" << legacyTime / newTime << "x\n";
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
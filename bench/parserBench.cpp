@@ -0,0 +1,230 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  Parser Hot-Path Benchmark
+ * ----------------------------------------------------------------------------
+ *  Times the parsing functions every fetched page goes through, over the
+ *  HTML corpus in bench/corpus (a small page, a news article, a minified
+ *  shop page and a link-dense directory) plus a huge page made of the
+ *  corpus repeated to 8 MB:
+ *    - extractUrls, and LinkExtractor fed in 4 KB chunks as HostConnection
+ *      does while a body streams in
+ *    - reformatHttpResponse
+ *    - verifyUrl, verifyType and verifyDomain, and getHostnameFromUrl and
+ *      getHostPathFromUrl, over every http(s) URL candidate of the page
+ *  Each result is nanoseconds per input byte (page bytes, or URL bytes for
+ *  the per-URL functions) and heap allocations per page, counted by the
+ *  global operator new below.
+ *
+ *  Usage: parserBench [--corpus directory] [page.html ...]
+ *  Pages given as arguments replace the corpus.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "../parser.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+size_t allocationCount = 0;          // The benchmark is single-threaded
+
+}
+
+void* operator new(size_t size) {
+    allocationCount++;
+    if (void* memory = malloc(size ? size : 1)) return memory;
+    throw bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+namespace {
+
+const char* const corpusPages[] = {"small.html", "article.html", "minified.html", "linkDense.html"};
+const size_t hugePageBytes = 8 << 20;
+
+volatile size_t sink;                // Keeps results from being optimized away
+
+struct Page {
+    string name;
+    string html;
+    vector<string> urls;             // http(s) URL candidates
+    size_t urlBytes = 0;
+};
+
+bool readFile(const string& path, string& content) {
+    ifstream file(path, ios::binary);
+    if (!file) return false;
+    stringstream text;
+    text << file.rdbuf();
+    content = text.str();
+    return true;
+}
+
+// Every "http" run up to a quote, space or bracket, roughly what the link
+// extractor captures
+void collectUrls(Page& page) {
+    const string& html = page.html;
+    size_t pos = 0;
+    while ((pos = html.find("http", pos)) != string::npos) {
+        size_t end = html.find_first_of("\"' <>", pos);
+        if (end == string::npos) end = html.size();
+        if (html.compare(pos, 7, "http://") == 0 || html.compare(pos, 8, "https://") == 0) {
+            page.urls.push_back(html.substr(pos, end - pos));
+            page.urlBytes += end - pos;
+        }
+        pos = end;
+    }
+}
+
+struct Result {
+    double nsPerByte;
+    size_t allocations;              // Per call, i.e. per page
+};
+
+// One warm-up call, one counted call, then repeated calls for at least
+// 0.3 s to time fn
+template<typename Fn>
+Result measure(size_t bytes, Fn fn) {
+    fn();
+    size_t before = allocationCount;
+    fn();
+    Result result;
+    result.allocations = allocationCount - before;
+
+    size_t iterations = 0;
+    auto start = steady_clock::now();
+    auto elapsed = steady_clock::duration::zero();
+    do {
+        fn();
+        iterations++;
+        elapsed = steady_clock::now() - start;
+    } while (elapsed < milliseconds(300));
+
+    result.nsPerByte = bytes ? duration<double, nano>(elapsed).count() / (double(iterations) * bytes) : 0;
+    return result;
+}
+
+void printRow(const char* benchmark, const Page& page, size_t bytes, const Result& result) {
+    cout << left << setw(22) << benchmark << setw(16) << page.name << right
+         << setw(10) << bytes
+         << setw(10) << setprecision(3) << result.nsPerByte
+         << setw(10) << result.allocations << "\n";
+}
+
+void runPage(const Page& page) {
+    const string& html = page.html;
+    const vector<string>& urls = page.urls;
+
+    printRow("extractUrls", page, html.size(), measure(html.size(), [&] {
+        sink = extractUrls(html).size();
+    }));
+
+    LinkExtractor extractor;
+    printRow("LinkExtractor 4K", page, html.size(), measure(html.size(), [&] {
+        extractor.reset();
+        for (size_t pos = 0; pos < html.size(); pos += 4096) {
+            extractor.feed(html.data() + pos, min<size_t>(4096, html.size() - pos));
+        }
+        sink = extractor.links().size();
+    }));
+
+    printRow("reformatHttpResponse", page, html.size(), measure(html.size(), [&] {
+        sink = reformatHttpResponse(html).size();
+    }));
+
+    printRow("verifyUrl", page, page.urlBytes, measure(page.urlBytes, [&] {
+        size_t valid = 0;
+        for (const string& url : urls) valid += verifyUrl(url);
+        sink = valid;
+    }));
+
+    printRow("verifyType", page, page.urlBytes, measure(page.urlBytes, [&] {
+        size_t valid = 0;
+        for (const string& url : urls) valid += verifyType(url);
+        sink = valid;
+    }));
+
+    printRow("verifyDomain", page, page.urlBytes, measure(page.urlBytes, [&] {
+        size_t valid = 0;
+        for (const string& url : urls) valid += verifyDomain(getHostnameFromUrl(url));
+        sink = valid;
+    }));
+
+    printRow("getHostnameFromUrl", page, page.urlBytes, measure(page.urlBytes, [&] {
+        size_t length = 0;
+        for (const string& url : urls) length += getHostnameFromUrl(url).size();
+        sink = length;
+    }));
+
+    printRow("getHostPathFromUrl", page, page.urlBytes, measure(page.urlBytes, [&] {
+        size_t length = 0;
+        for (const string& url : urls) length += getHostPathFromUrl(url).size();
+        sink = length;
+    }));
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    string corpus = "bench/corpus";
+    vector<Page> pages;
+
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--corpus" && i + 1 < argc) {
+            corpus = argv[++i];
+            continue;
+        }
+        Page page;
+        page.name = argv[i];
+        if (!readFile(argv[i], page.html)) {
+            cerr << "Cannot open " << argv[i] << endl;
+            return 1;
+        }
+        pages.push_back(move(page));
+    }
+
+    if (pages.empty()) {
+        string huge;
+        for (const char* name : corpusPages) {
+            Page page;
+            page.name = name;
+            if (!readFile(corpus + "/" + name, page.html)) {
+                cerr << "Cannot open " << corpus << "/" << name << " (run from the repository root or pass --corpus)" << endl;
+                return 1;
+            }
+            huge += page.html;
+            pages.push_back(move(page));
+        }
+
+        Page page;
+        page.name = "huge (corpus)";
+        while (page.html.size() < hugePageBytes) page.html += huge;
+        pages.push_back(move(page));
+    }
+
+    for (Page& page : pages) collectUrls(page);
+
+    cout << fixed;
+    cout << left << setw(22) << "Benchmark" << setw(16) << "Page" << right
+         << setw(10) << "Bytes" << setw(10) << "ns/B" << setw(10) << "Allocs" << "\n";
+    for (const Page& page : pages) runPage(page);
+
+    return 0;
+}
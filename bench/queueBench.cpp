@@ -0,0 +1,128 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  Frontier Queue Contention Benchmark
+ * ----------------------------------------------------------------------------
+ *  Pushes and pops frontier-sized entries (a hostname and a depth) through
+ *  the lock-free Queue<T> and, as the baseline, through a deque guarded by a
+ *  single mutex (the shape of the previous frontier). Half of the threads
+ *  produce and half consume; with one thread it alternates push and pop.
+ *
+ *  Usage: queueBench [operations]
+ *  Prints million operations (a push plus its pop) per second at 1, 4, 16
+ *  and 64 threads.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "../parser.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+struct Entry {
+    string hostname;
+    int depth = 0;
+};
+
+class LockedQueue {
+public:
+    bool push(Entry&& entry) {
+        lock_guard<mutex> lock(queueMutex);
+        entries.push_back(move(entry));
+        return true;
+    }
+
+    bool pop(Entry& entry) {
+        lock_guard<mutex> lock(queueMutex);
+        if (entries.empty()) return false;
+        entry = move(entries.front());
+        entries.pop_front();
+        return true;
+    }
+
+private:
+    mutex queueMutex;
+    deque<Entry> entries;
+};
+
+Entry makeEntry(size_t index) {
+    Entry entry;
+    entry.hostname = "site" + to_string(index % 1000) + ".example.com";
+    entry.depth = (int)(index % 7);
+    return entry;
+}
+
+// Runs operations pushes and as many pops on threads threads and returns
+// the elapsed time in seconds
+template<typename QueueType>
+double run(QueueType& queue, int threads, size_t operations) {
+    auto start = steady_clock::now();
+
+    if (threads == 1) {
+        Entry entry;
+        for (size_t i = 0; i < operations; i++) {
+            while (!queue.push(makeEntry(i))) {}
+            while (!queue.pop(entry)) {}
+        }
+        return duration<double>(steady_clock::now() - start).count();
+    }
+
+    int producers = threads / 2;
+    int consumers = threads - producers;
+    atomic<size_t> consumed(0);
+    vector<thread> workers;
+
+    for (int p = 0; p < producers; p++) {
+        workers.push_back(thread([&queue, p, producers, operations] {
+            for (size_t i = p; i < operations; i += producers) {
+                Entry entry = makeEntry(i);
+                while (!queue.push(move(entry))) this_thread::yield();
+            }
+        }));
+    }
+    for (int c = 0; c < consumers; c++) {
+        workers.push_back(thread([&queue, &consumed, operations] {
+            Entry entry;
+            while (consumed.load(memory_order_relaxed) < operations) {
+                if (queue.pop(entry)) consumed.fetch_add(1, memory_order_relaxed);
+                else this_thread::yield();
+            }
+        }));
+    }
+    for (auto& worker : workers) worker.join();
+
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t operations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    const int threadCounts[] = {1, 4, 16, 64};
+
+    cout << fixed << setprecision(2);
+    cout << "Threads\tMutex Mops/s\tLock-free Mops/s\tSpeed-up\n";
+
+    for (int threads : threadCounts) {
+        LockedQueue locked;
+        Queue<Entry> lockFree(65536);
+
+        double lockedTime = run(locked, threads, operations);
+        double lockFreeTime = run(lockFree, threads, operations);
+
+        cout << threads << "\t" << operations / lockedTime / 1e6 << "\t"
+             << operations / lockFreeTime / 1e6 << "\t" << lockedTime / lockFreeTime << "x\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  BloomFilter Implementation
+ * ----------------------------------------------------------------------------
+ *  Kirsch-Mitzenmacher double hashing: probe i tests bit (h1 + i * h2).
+ *  h1 is the fingerprint itself (already well mixed by fingerprint64) and
+ *  h2 is derived from its other half, forced odd so probes never repeat
+ *  within a power-of-two table.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "bloomFilter.h"
+#include <cmath>
+#include <algorithm>
+
+BloomFilter::BloomFilter(size_t expectedItems, double falsePositiveRate) : insertCount(0) {
+    const double ln2 = log(2.0);
+    double items = (double)max<size_t>(expectedItems, 1);
+    double bits = ceil(-items * log(falsePositiveRate) / (ln2 * ln2));
+
+    uint64_t size = 64;
+    while ((double)size < bits) size <<= 1;
+    mask = size - 1;
+    probes = max(1, min(32, (int)lround(bits / items * ln2)));
+
+    words.reset(new atomic<uint64_t>[size / 64]);
+    for (uint64_t i = 0; i < size / 64; i++) words[i].store(0, memory_order_relaxed);
+}
+
+bool BloomFilter::insert(uint64_t fingerprint) {
+    uint64_t h2 = ((fingerprint >> 32) | (fingerprint << 32)) * 0x9e3779b97f4a7c15ULL | 1;
+    uint64_t h = fingerprint;
+    bool fresh = false;
+
+    for (int i = 0; i < probes; i++, h += h2) {
+        uint64_t bit = h & mask;
+        uint64_t flag = 1ULL << (bit & 63);
+        // Skip the read-modify-write when the bit is already set; most
+        // probes of a seen fingerprint then stay read-only on shared lines
+        if (words[bit >> 6].load(memory_order_relaxed) & flag) continue;
+        if (!(words[bit >> 6].fetch_or(flag, memory_order_relaxed) & flag)) fresh = true;
+    }
+
+    if (fresh) insertCount.fetch_add(1, memory_order_relaxed);
+    return fresh;
+}
+
+bool BloomFilter::mightContain(uint64_t fingerprint) const {
+    uint64_t h2 = ((fingerprint >> 32) | (fingerprint << 32)) * 0x9e3779b97f4a7c15ULL | 1;
+    uint64_t h = fingerprint;
+
+    for (int i = 0; i < probes; i++, h += h2) {
+        uint64_t bit = h & mask;
+        if (!(words[bit >> 6].load(memory_order_relaxed) & (1ULL << (bit & 63)))) return false;
+    }
+    return true;
+}
+
+double BloomFilter::estimatedFalsePositiveRate() const {
+    double fill = 1.0 - exp(-(double)probes * (double)insertCount.load() / (double)bitCount());
+    return pow(fill, probes);
+}
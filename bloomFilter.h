@@ -0,0 +1,61 @@
+/*
+* ----------------------------------------------------------------------------
+ *  BloomFilter Header - Lock-Free Probabilistic "Seen" Filter
+ * ----------------------------------------------------------------------------
+ *  This header defines the BloomFilter class, a fixed-size bit array that
+ *  answers "has this fingerprint been seen?" with no false negatives and a
+ *  configurable false-positive rate. It is used in front of, or instead of,
+ *  the exact discoveredSites set for crawls over millions of hosts, where
+ *  the exact set would grow without bound.
+ *
+ *  Key Features:
+ *  - Sized from the expected number of items and the target false-positive
+ *    rate (m = -n ln p / ln^2 2 bits, k = m/n ln 2 probes).
+ *  - Bit count rounded up to a power of two, so the real rate is at or
+ *    below the configured one until the expected count is exceeded.
+ *  - Probes derived from one 64-bit fingerprint by double hashing.
+ *  - Lock-free concurrent inserts (atomic fetch_or on 64-bit words).
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+class BloomFilter {
+public:
+    BloomFilter(size_t expectedItems, double falsePositiveRate);
+
+    // Sets the fingerprint's bits. Returns true when at least one bit was
+    // clear, i.e. the fingerprint was definitely not inserted before. Two
+    // threads racing to insert the same new fingerprint may both get true.
+    bool insert(uint64_t fingerprint);
+
+    // False means definitely never inserted; true means probably inserted
+    bool mightContain(uint64_t fingerprint) const;
+
+    size_t size() const { return insertCount.load(); }   // Inserts that returned true
+    size_t bitCount() const { return mask + 1; }
+    int hashCount() const { return probes; }
+    size_t memoryBytes() const { return (mask + 1) / 8; }
+
+    // False-positive rate expected at the current fill level
+    double estimatedFalsePositiveRate() const;
+
+private:
+    unique_ptr<atomic<uint64_t>[]> words;
+    uint64_t mask;                   // bitCount() - 1
+    int probes;                      // Bits set per fingerprint
+    atomic<size_t> insertCount;
+
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+};
+
+#endif
@@ -6,204 +6,998 @@
  *  It handles HTTP connections, page retrieval, and statistics gathering in a
  *  thread-safe manner. The implementation is designed to work with a
  *  multi-threaded crawler system.
+ *
+ *  All socket I/O is non-blocking and driven by resumable state machines:
+ *  HostConnection fetches one page (connect -> send -> receive), and
+ *  ClientSocket::advance() walks a site's pages over one connection, paced
+ *  by the site's HostBudget. Blocking callers simply wait on the socket
+ *  between steps; the asynchronous engine multiplexes many sites per thread
+ *  and the worker pool runs individual pages through the page interface.
  * ----------------------------------------------------------------------------
  */
 
 #include "clientSocket.h"
+#include "dnsCache.h"
+#include "robots.h"
 #include <chrono>
 #include <stdexcept>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
 
 using namespace std::chrono;
 
-ClientSocket::ClientSocket(string hostname, int port, int pagesLimit, int crawlDelay)
-    : hostname(hostname), port(port), pagesLimit(pagesLimit), crawlDelay(crawlDelay), sock(INVALID_SOCKET) {
+namespace {
 
-    // Initialize Winsock
-    if (!initializeWinsock()) {
-        throw runtime_error("Failed to initialize Winsock");
+const int defaultTimeoutMs = 10000;   // Connect, send and receive timeout until setTimeout()
+const size_t maxRobotsBytes = 512 * 1024;   // robots.txt past this size is ignored (RFC 9309 asks for at least 500 KB)
+const int maxRobotsRedirects = 5;   // RFC 9309 follows at least five
+const int dnsPollMs = 5;   // How often a pending background lookup is checked
+const size_t maxDrainBytes = 16 * 1024;   // Unwanted bodies up to this size are read to keep the connection
+
+int64_t microsSince(steady_clock::time_point start) {
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+// A missing Content-Type is given the benefit of the doubt
+bool isHtmlContentType(string type) {
+    type = type.substr(0, type.find(';'));
+    type.erase(remove(type.begin(), type.end(), ' '), type.end());
+    for (char& ch : type) ch = (char)tolower((unsigned char)ch);
+    return type.empty() || type == "text/html" || type == "application/xhtml+xml";
+}
+
+// Splits a Location header into host (empty for the current host) and a
+// canonical path, resolving relative references against currentPath.
+// secure is set for https:// targets and left alone for relative ones.
+void resolveLocation(string_view location, string_view currentPath, string& host, string& path, bool& secure) {
+    location = location.substr(0, location.find('#'));
+
+    if (location.compare(0, 7, "http://") == 0 || location.compare(0, 8, "https://") == 0) {
+        secure = location[4] == 's';
+        host = string(getHostnameFromUrl(location));
+        location = getHostPathFromUrl(location);
+    } else if (location.compare(0, 2, "//") == 0) {
+        string_view rest = location.substr(2);
+        size_t slash = rest.find('/');
+        host = string(rest.substr(0, slash));
+        location = slash == string_view::npos ? string_view("/") : rest.substr(slash);
+    } else {
+        host.clear();
     }
+    for (char& ch : host) ch = (char)tolower((unsigned char)ch);
 
-    // Add initial page to pending queue
-    pendingPages.add("/", "");
-    discoveredPages["/"] = true;
+    string relative;
+    if (location.empty() || location[0] != '/') {
+        relative = string(currentPath.substr(0, currentPath.rfind('/') + 1));
+        relative.append(location.data(), location.size());
+        location = relative;
+    }
+
+    size_t query = location.find('?');
+    path = canonicalizePath(location.substr(0, query));
+    if (query != string_view::npos) path.append(location.data() + query, location.size() - query);
 }
 
-ClientSocket::~ClientSocket() {
-    cleanup();
 }
 
-bool ClientSocket::initializeWinsock() {
-    WSADATA wsaData;
-    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+// ----------------------------------------------------------------------------
+// Blocking wait helper
+// ----------------------------------------------------------------------------
+void waitForSocket(SOCKET sock, IoWait wait, steady_clock::time_point deadline) {
+    auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+    if (remaining < 0) remaining = 0;
+
+    if (wait == IoWait::Timer || sock == INVALID_SOCKET) {
+        sleepMs(remaining);
+        return;
+    }
+    if (wait == IoWait::Done) return;
+
+    waitSocket(sock, wait == IoWait::Write, remaining);
 }
 
-bool ClientSocket::createSocket() {
+// ----------------------------------------------------------------------------
+// HostConnection
+// ----------------------------------------------------------------------------
+size_t HostConnection::maxPageBytes = 0;
+string HostConnection::userAgent;
+
+void HostConnection::configure(size_t maxBytes, const string& agent) {
+    maxPageBytes = maxBytes;
+    userAgent = agent;
+}
+
+HostConnection::HostConnection(const string& hostname, int port, bool keepAlive, bool secure)
+    : hostname(hostname), port(port), keepAlive(keepAlive), secure(secure), sock(INVALID_SOCKET), requestsOnSocket(0),
+      asyncDns(false),       phase(Phase::Idle), bytesSent(0), reusedConnection(false), retried(false), opened(false),
+      success(false), result(FetchOutcome::Failed), haveCached(false), fromCache(false), brokenPipeline(false),
+      pipelinedPage(false), rawBody(false), discardBody(false), timeoutMs(defaultTimeoutMs), responseTime(-1), deadline(steady_clock::now()) {
+    fill(begin(phaseMicros), end(phaseMicros), -1);
+    // Body bytes go straight from the recv buffer into the link extractor
+    response.setBodySink([this](const char* data, size_t length) { receiveBody(data, length); });
+    response.setHeaderCheck([this](const HttpResponse&) { return acceptHeaders(); });
+}
+
+HostConnection::~HostConnection() {
+    closeConnection();
+}
+
+bool HostConnection::createSocket() {
     sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 
     if (sock == INVALID_SOCKET) {
         return false;
     }
 
-    // Set socket timeout to prevent hanging
-    DWORD timeout = 10000;  // 10 seconds
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
-    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (char*)&timeout, sizeof(timeout));
+    // Timeouts are enforced by the state machine, so the socket never blocks
+    if (!setNonBlocking(sock)) {
+        closeSocket(sock);
+        sock = INVALID_SOCKET;
+        return false;
+    }
 
     return true;
 }
 
-bool ClientSocket::connectToHost() {
-    struct hostent *host = gethostbyname(hostname.c_str());
-    if (!host) return false;
-
-    SOCKADDR_IN sockAddr;
+// Starts a non-blocking connect; completion is detected in the Connecting phase
+bool HostConnection::connectToHost(const SOCKADDR_IN& address) {
+    SOCKADDR_IN sockAddr = address;
     sockAddr.sin_family = AF_INET;
     sockAddr.sin_port = htons(port);
-    sockAddr.sin_addr.s_addr = *((unsigned long*)host->h_addr);
 
-    // Set non-blocking mode for connect timeout
-    unsigned long mode = 1;
-    ioctlsocket(sock, FIONBIO, &mode);
+    if (connect(sock, (SOCKADDR*)(&sockAddr), sizeof(sockAddr)) == SOCKET_ERROR && !socketWouldBlock()) {
+        return false;
+    }
+    phaseStart = steady_clock::now();
+    return true;
+}
 
-    connect(sock, (SOCKADDR*)(&sockAddr), sizeof(sockAddr));
+void HostConnection::closeConnection() {
+    if (sock != INVALID_SOCKET) {
+        tls.close();
+        closeSocket(sock);
+        sock = INVALID_SOCKET;
+    }
+    requestsOnSocket = 0;
+}
+
+string HostConnection::createHttpRequest(string host, string path, const ResponseCache::Entry* entry) {
+    string validators;
+    if (entry) {
+        if (!entry->etag.empty()) validators += "If-None-Match: " + entry->etag + "\r\n";
+        if (!entry->lastModified.empty()) validators += "If-Modified-Since: " + entry->lastModified + "\r\n";
+    }
+
+    return "GET " + path + " HTTP/1.1\r\n"
+           "Host: " + host + "\r\n" +
+           (userAgent.empty() ? string() : "User-Agent: " + userAgent + "\r\n") +
+           "Accept-Encoding: " + ContentDecoder::acceptEncoding() + "\r\n" + validators +
+           (keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+}
+
+void HostConnection::resetPage(const string& pagePath) {
+    path = pagePath;
+    retried = false;
+    opened = false;
+    success = false;
+    result = FetchOutcome::Failed;
+    location.clear();
+    fromCache = false;
+    pipelinedPage = false;
+    rawBody = pagePath == RobotsRules::path;
+    discardBody = false;
+    body.clear();
+    fill(begin(phaseMicros), end(phaseMicros), -1);
+}
+
+void HostConnection::start(const string& pagePath, const vector<string>& pipelinedPaths) {
+    resetPage(pagePath);
+    haveCached = ResponseCache::shared().lookup(hostname + path, cached);
+
+    pipelined.clear();
+    leftover.clear();
+    brokenPipeline = false;
+    for (const string& next : pipelinedPaths) {
+        PipelinedRequest queued;
+        queued.path = next;
+        queued.haveCached = ResponseCache::shared().lookup(hostname + next, queued.cached);
+        pipelined.push_back(move(queued));
+    }
+
+    if (!beginRequest()) finish(false);
+}
+
+// The next request is already out, so its response may even be buffered
+// in leftover; response time is measured from here, which is the latency
+// pipelining hides
+bool HostConnection::startNext() {
+    if (pipelined.empty() || sock == INVALID_SOCKET || brokenPipeline) return false;
+
+    PipelinedRequest next = move(pipelined.front());
+    pipelined.pop_front();
+    resetPage(next.path);
+    haveCached = next.haveCached;
+    cached = move(next.cached);
+    pipelinedPage = true;
+
+    response.reset();
+    extractor.reset();
+    responseTime = -1;
+    reusedConnection = true;
+    requestStart = high_resolution_clock::now();
+    requestSent = steady_clock::now();
+    deadline = steady_clock::now() + milliseconds(timeoutMs);
+    phase = Phase::Receiving;
+    return true;
+}
 
-    // Wait for connection with timeout
-    fd_set fdset;
-    struct timeval tv;
-    tv.tv_sec = 10;
-    tv.tv_usec = 0;
+vector<string> HostConnection::takeUnanswered() {
+    vector<string> paths;
+    for (PipelinedRequest& queued : pipelined) paths.push_back(move(queued.path));
+    pipelined.clear();
+    return paths;
+}
 
-    FD_ZERO(&fdset);
-    FD_SET(sock, &fdset);
+bool HostConnection::wait() {
+    IoWait wait;
+    while ((wait = advance()) != IoWait::Done) {
+        waitForSocket(sock, wait, deadline);
+    }
+    return success;
+}
 
-    if (select(0, NULL, &fdset, NULL, &tv) == 1) {
-        // Set back to blocking mode
-        mode = 0;
-        ioctlsocket(sock, FIONBIO, &mode);
+bool HostConnection::fetch(const string& pagePath) {
+    start(pagePath);
+    return wait();
+}
+
+// Prepares the request for path, reusing the open connection when possible
+bool HostConnection::beginRequest() {
+    request = createHttpRequest(hostname, path, haveCached ? &cached : nullptr);
+    for (const PipelinedRequest& queued : pipelined) {
+        if (brokenPipeline) break;
+        request += createHttpRequest(hostname, queued.path, queued.haveCached ? &queued.cached : nullptr);
+    }
+    leftover.clear();
+    bytesSent = 0;
+    response.reset();
+    extractor.reset();
+    responseTime = -1;
+    deadline = steady_clock::now() + milliseconds(timeoutMs);
+
+    reusedConnection = sock != INVALID_SOCKET;
+    if (reusedConnection) {
+        phase = Phase::Sending;
         return true;
     }
 
-    return false;
+    dnsLookup.reset();
+    phaseStart = steady_clock::now();
+    phase = Phase::Resolving;
+    return true;
 }
 
-void ClientSocket::cleanup() {
-    if (sock != INVALID_SOCKET) {
-        closesocket(sock);
-        sock = INVALID_SOCKET;
+void HostConnection::finish(bool ok) {
+    if (phaseMicros[(int)Metric::FirstByte] >= 0) phaseMicros[(int)Metric::Download] = microsSince(firstByte);
+    // A drained body keeps the outcome its headers decided
+    success = ok && !discardBody;
+    if (success) result = FetchOutcome::Fetched;
+    else if (!ok && !response.aborted() && !discardBody) result = FetchOutcome::Failed;
+    if (ok) requestsOnSocket++;
+    if (success) updateCache();
+    if (!ok || !keepAlive || !response.keepAlive()) {
+        // Our own aborts aside, losing queued requests means the server
+        // does not handle pipelining
+        if (!ok && !pipelined.empty() && !response.aborted()) brokenPipeline = true;
+        closeConnection();
     }
-    WSACleanup();
+    phase = Phase::Idle;
 }
 
-string ClientSocket::createHttpRequest(string host, string path) {
-    return "GET " + path + " HTTP/1.1\r\n"
-           "Host: " + host + "\r\n"
-           "Connection: close\r\n\r\n";
+// Runs before any body byte is read, so redirects and pages that are not
+// HTML or too large cost only their headers, plus a short body when that
+// keeps the connection open
+bool HostConnection::acceptHeaders() {
+    int status = response.statusCode();
+    if (status == 301 || status == 302 || status == 303 || status == 307 || status == 308) {
+        location = response.header("Location");
+        if (!location.empty()) {
+            result = FetchOutcome::Redirected;
+            return drainBody(true);
+        }
+    }
+
+    if (status < 200 || status >= 300 || rawBody) return true;
+
+    if (!isHtmlContentType(response.header("Content-Type"))) {
+        result = FetchOutcome::NotHtml;
+        return drainBody(false);
+    }
+
+    string contentLength = response.header("Content-Length");
+    if (maxPageBytes > 0 && !contentLength.empty() && strtoull(contentLength.c_str(), nullptr, 10) > maxPageBytes) {
+        result = FetchOutcome::TooLarge;
+        return false;
+    }
+    return true;
 }
 
-SiteStats ClientSocket::startDiscovering() {
-    // Initialize statistics object
-    SiteStats stats;
-    stats.hostname = hostname;
-    stats.averageResponseTime = -1;
-    stats.minResponseTime = -1;
-    stats.maxResponseTime = -1;
-    stats.numberOfPagesFailed = 0;
+// Reading an unwanted body is cheaper than a new connection only while it
+// is short: a declared length up to maxDrainBytes, or for redirects
+// (whose bodies are a line of HTML) a chunked body cut off past it
+bool HostConnection::drainBody(bool allowChunked) {
+    if (!keepAlive || !response.keepAlive()) return false;
+
+    string transferEncoding = response.header("Transfer-Encoding");
+    for (char& ch : transferEncoding) ch = (char)tolower((unsigned char)ch);
+    string contentLength = response.header("Content-Length");
+    if (transferEncoding.find("chunked") != string::npos) discardBody = allowChunked;
+    else discardBody = !contentLength.empty() && strtoull(contentLength.c_str(), nullptr, 10) <= maxDrainBytes;
+    return discardBody;
+}
+
+// Lengths of chunked or compressed bodies are only known as they arrive
+void HostConnection::receiveBody(const char* data, size_t length) {
+    if (discardBody) {
+        if (response.bytesDecoded() > maxDrainBytes) response.abort();
+        return;
+    }
+
+    if (rawBody) {
+        body.append(data, min(length, maxRobotsBytes - min(maxRobotsBytes, body.size())));
+        return;
+    }
+
+    if (maxPageBytes > 0 && response.bytesDecoded() > maxPageBytes) {
+        result = FetchOutcome::TooLarge;
+        response.abort();
+        return;
+    }
 
-    // Main crawling loop
-    while (!pendingPages.empty() && (pagesLimit == -1 || int(stats.visitedPages.size()) < pagesLimit)) {
-        string path = pendingPages.front();
-        pendingPages.pop();
+    auto parseStart = steady_clock::now();
+    extractor.feed(data, length);
+    int64_t& parse = phaseMicros[(int)Metric::Parse];
+    parse = max<int64_t>(parse, 0) + microsSince(parseStart);
+}
 
-        // Implement crawl delay except for initial page
-        if (path != "/") {
-            Sleep(crawlDelay);
+// On 304 the cached links stand in for the body that was not sent; a fresh
+// 200 with validators replaces the cache entry
+void HostConnection::updateCache() {
+    ResponseCache& cache = ResponseCache::shared();
+    if (!cache.enabled() || rawBody) return;
+
+    if (response.statusCode() == 304 && haveCached) {
+        extractor.links() = move(cached.links);
+        fromCache = true;
+        cache.recordRevalidation();
+        return;
+    }
+
+    if (response.statusCode() == 200) {
+        string etag = response.header("ETag");
+        string lastModified = response.header("Last-Modified");
+        if (!etag.empty() || !lastModified.empty()) {
+            cache.store(hostname + path, etag, lastModified, extractor.links());
         }
+    }
+}
 
-        // Create and connect socket
-        if (!createSocket() || !connectToHost()) {
-            stats.numberOfPagesFailed++;
-            cleanup();
-            continue;
+// A reused keep-alive connection may have been closed by the server while
+// idle; in that case the request is retried once on a fresh connection.
+void HostConnection::connectionFailed() {
+    bool stale = reusedConnection && !response.receivedAnything() && !retried;
+    if (stale && pipelinedPage) brokenPipeline = true;   // Retried alone, the rest is left unanswered
+    closeConnection();
+    if (stale) {
+        retried = true;
+        if (beginRequest()) return;
+    }
+    finish(false);
+}
+
+IoWait HostConnection::advance() {
+    while (true) {
+        switch (phase) {
+        case Phase::Idle:
+            return IoWait::Done;
+
+        case Phase::Resolving: {
+            // A cache miss would stall every session of an event loop, so
+            // there the lookup runs on the resolver threads and is polled
+            SOCKADDR_IN address;
+            DnsCache::Answer answer;
+            if (asyncDns) answer = DnsCache::shared().resolveAsync(hostname, address, dnsLookup);
+            else answer = DnsCache::shared().resolve(hostname, address) ? DnsCache::Answer::Found : DnsCache::Answer::NotFound;
+
+            if (answer == DnsCache::Answer::Pending) {
+                auto now = steady_clock::now();
+                if (now >= phaseStart + milliseconds(timeoutMs)) {
+                    dnsLookup.reset();   // Left to finish for the cache
+                    finish(false);
+                    break;
+                }
+                deadline = min(phaseStart + milliseconds(timeoutMs), now + milliseconds(dnsPollMs));
+                return IoWait::Timer;
+            }
+
+            phaseMicros[(int)Metric::Dns] = microsSince(phaseStart);
+            if (answer == DnsCache::Answer::NotFound || !createSocket() || !connectToHost(address)) {
+                closeConnection();
+                finish(false);
+                break;
+            }
+            opened = true;
+            deadline = steady_clock::now() + milliseconds(timeoutMs);
+            phase = Phase::Connecting;
+            break;
         }
 
-        // Send HTTP request and measure response time
-        string request = createHttpRequest(hostname, path);
-        auto startTime = high_resolution_clock::now();
+        case Phase::Connecting: {
+            // Poll the pending connect without waiting; failures show up as
+            // an error readiness and as SO_ERROR
+            SocketReady ready = waitSocket(sock, true, 0);
+            if (ready == SocketReady::Timeout) {
+                if (steady_clock::now() >= deadline) finish(false);
+                else return IoWait::Write;
+                break;
+            }
 
-        if (send(sock, request.c_str(), (int)request.length(), 0) == SOCKET_ERROR) {
-            stats.numberOfPagesFailed++;
-            cleanup();
-            continue;
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(sock, SOL_SOCKET, SO_ERROR, (char*)&error, &length);
+            if (error != 0 || ready == SocketReady::Error) {
+                finish(false);
+                break;
+            }
+            phaseMicros[(int)Metric::Connect] = microsSince(phaseStart);
+            if (secure && !tls.begin(sock, hostname)) {
+                finish(false);
+                break;
+            }
+            phaseStart = steady_clock::now();
+            phase = secure ? Phase::Handshaking : Phase::Sending;
+            break;
+        }
+
+        case Phase::Handshaking: {
+            TlsStream::Status status = tls.handshake();
+            if (status == TlsStream::Status::Ok) {
+                phaseMicros[(int)Metric::Handshake] = microsSince(phaseStart);
+                phase = Phase::Sending;
+            } else if (status == TlsStream::Status::WantRead || status == TlsStream::Status::WantWrite) {
+                if (steady_clock::now() >= deadline) finish(false);
+                else return status == TlsStream::Status::WantRead ? IoWait::Read : IoWait::Write;
+            } else {
+                finish(false);
+            }
+            break;
+        }
+
+        case Phase::Sending: {
+            if (bytesSent == 0) {
+                requestStart = high_resolution_clock::now();
+                phaseStart = steady_clock::now();
+            }
+            IoWait wait;
+            int sent = sendBytes(request.c_str() + bytesSent, (int)(request.length() - bytesSent), wait);
+            if (sent < 0) {
+                if (wait == IoWait::Done) connectionFailed();
+                else if (steady_clock::now() >= deadline) finish(false);
+                else return wait;
+                break;
+            }
+            bytesSent += sent;
+            if (bytesSent == request.length()) {
+                requestSent = steady_clock::now();
+                phaseMicros[(int)Metric::Send] = microsSince(phaseStart);
+                deadline = requestSent + milliseconds(timeoutMs);
+                phase = Phase::Receiving;
+            }
+            break;
         }
 
-        // Receive response
-        string response;
-        char buffer[4096];
-        double responseTime = -1;
+        case Phase::Receiving: {
+            if (!leftover.empty()) {
+                string buffered;
+                buffered.swap(leftover);
+                receive(buffered.data(), buffered.size());
+                break;
+            }
+
+            char buffer[4096];
+            IoWait wait;
+            int bytesRead = recvBytes(buffer, sizeof(buffer), wait);
 
-        while (true) {
-            int bytesRead = recv(sock, buffer, sizeof(buffer) - 1, 0);
-            if (bytesRead <= 0) break;
+            if (bytesRead < 0) {
+                if (wait == IoWait::Done) connectionFailed();
+                else if (steady_clock::now() >= deadline) finish(false);
+                else return wait;
+                break;
+            }
 
-            // Calculate response time on first data received
-            if (responseTime < -0.5) {
-                auto endTime = high_resolution_clock::now();
-                responseTime = duration<double, milli>(endTime - startTime).count();
+            if (bytesRead == 0) {
+                response.finishOnClose();
+                if (response.complete()) finish(true);
+                else connectionFailed();
+                break;
             }
 
-            buffer[bytesRead] = '\0';
-            response += buffer;
+            receive(buffer, bytesRead);
+            break;
+        }
         }
+    }
+}
 
-        closesocket(sock);
-        sock = INVALID_SOCKET;
+// Plain or TLS transfer. Returns the bytes moved, 0 when the peer closed
+// the connection, or -1 with wait set to the direction the socket is
+// blocked in (Done when the connection failed).
+int HostConnection::sendBytes(const char* data, int length, IoWait& wait) {
+    if (!secure) {
+        int sent = send(sock, data, length, 0);
+        if (sent != SOCKET_ERROR) return sent;
+        wait = socketWouldBlock() ? IoWait::Write : IoWait::Done;
+        return -1;
+    }
+
+    int sent;
+    TlsStream::Status status = tls.write(data, length, sent);
+    if (status == TlsStream::Status::Ok) return sent;
+    if (status == TlsStream::Status::WantRead) wait = IoWait::Read;
+    else if (status == TlsStream::Status::WantWrite) wait = IoWait::Write;
+    else wait = IoWait::Done;
+    return -1;
+}
+
+int HostConnection::recvBytes(char* buffer, int length, IoWait& wait) {
+    if (!secure) {
+        int received = recv(sock, buffer, length, 0);
+        if (received != SOCKET_ERROR) return received;
+        wait = socketWouldBlock() ? IoWait::Read : IoWait::Done;
+        return -1;
+    }
+
+    int received;
+    TlsStream::Status status = tls.read(buffer, length, received);
+    if (status == TlsStream::Status::Ok) return received;
+    if (status == TlsStream::Status::Closed) return 0;
+    if (status == TlsStream::Status::WantRead) wait = IoWait::Read;
+    else if (status == TlsStream::Status::WantWrite) wait = IoWait::Write;
+    else wait = IoWait::Done;
+    return -1;
+}
 
-        // Store page statistics
-        string fullUrl = hostname + path;
-        stats.visitedPages.push_back(PageStats(fullUrl, responseTime));
-        stats.discoveredPages.add(fullUrl, to_string(responseTime));
+// Bytes past the end of the response belong to the next pipelined one
+void HostConnection::receive(const char* data, size_t length) {
+    // Calculate response time on first data received
+    if (responseTime < -0.5) {
+        auto endTime = high_resolution_clock::now();
+        responseTime = duration<double, milli>(endTime - requestStart).count();
+        firstByte = steady_clock::now();
+        phaseMicros[(int)Metric::FirstByte] = duration_cast<microseconds>(firstByte - requestSent).count();
+    }
+
+    size_t used = response.feed(data, length);
+    deadline = steady_clock::now() + milliseconds(timeoutMs);
+
+    if (response.complete()) {
+        if (used < length && !pipelined.empty()) leftover.assign(data + used, length - used);
+        finish(true);
+    } else if (response.failed() || response.aborted()) {
+        finish(false);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// ClientSocket
+// ----------------------------------------------------------------------------
+ClientSocket::ClientSocket(string hostname, int port, int pagesLimit, int crawlDelay, bool keepAlive,
+                           int maxConnections, double burst, size_t pageMemory, int pipelineDepth)
+    : hostname(hostname), port(port), pagesLimit(pagesLimit), keepAlive(keepAlive), secure(port == 443),
+      pipelineDepth(pipelineDepth), asyncDns(false), budget(crawlDelay > 0 ? 1000.0 / crawlDelay : 0, burst, maxConnections),
+      pendingPages(pageMemory), pagesInFlight(0), responseTimeSum(0), pipelining(keepAlive && pipelineDepth > 1),
+      robotsState(RobotsState::Ready), robotsRedirects(0), phase(Phase::NextPage), deadline(steady_clock::now()) {
 
-        // Update response time statistics
-        if (stats.minResponseTime < 0 || responseTime < stats.minResponseTime) {
-            stats.minResponseTime = responseTime;
+    // Initialize statistics object
+    stats.hostname = hostname;
+
+    // Add initial page to pending queue
+    pendingPages.push("/");
+    discoveredPages.insertUrl(hostname + "/");
+    discoveredPages.insertUrl(hostname + RobotsRules::path);   // Never crawled as a page
+
+    // Rules cached earlier in the crawl spare the fetch
+    RobotsCache& robotsCache = RobotsCache::shared();
+    if (robotsCache.enabled()) {
+        robots = robotsCache.lookup(hostname);
+        if (robots) applyCrawlDelay();
+        else robotsState = RobotsState::Unchecked;
+    }
+}
+
+// robots.txt goes out first and on its own; no page is handed out until
+// its rules are known, and pages they disallow are dropped here, which
+// also covers pages queued before a restore
+bool ClientSocket::takePage(string& path) {
+    lock_guard<mutex> lock(siteMutex);
+    if (robotsState == RobotsState::Fetching) return false;
+    if (robotsState == RobotsState::Unchecked) {
+        if (pendingPages.empty()) return false;
+        robotsState = RobotsState::Fetching;
+        path = RobotsRules::path;
+        pagesInFlight++;
+        return true;
+    }
+
+    while (!pendingPages.empty()) {
+        if (pagesLimit != -1 && int(stats.visitedPages.size()) + pagesInFlight >= pagesLimit) return false;
+
+        pendingPages.pop(path);
+        if (robots && !robots->allows(path)) {
+            stats.pagesDisallowed++;
+            continue;
         }
-        if (stats.maxResponseTime < 0 || responseTime > stats.maxResponseTime) {
-            stats.maxResponseTime = responseTime;
+        pagesInFlight++;
+        return true;
+    }
+    return false;
+}
+
+int ClientSocket::pagesAvailable() const {
+    lock_guard<mutex> lock(siteMutex);
+    if (robotsState != RobotsState::Ready) return robotsState == RobotsState::Unchecked && !pendingPages.empty() ? 1 : 0;
+    int available = (int)pendingPages.size();
+    if (pagesLimit != -1) {
+        available = min(available, pagesLimit - int(stats.visitedPages.size()) - pagesInFlight);
+    }
+    return max(0, available);
+}
+
+bool ClientSocket::isFinished() const {
+    lock_guard<mutex> lock(siteMutex);
+    bool limitReached = pagesLimit != -1 && int(stats.visitedPages.size()) >= pagesLimit;
+    return pagesInFlight == 0 && (pendingPages.empty() || limitReached);
+}
+
+unique_ptr<HostConnection> ClientSocket::acquireConnection() {
+    unique_ptr<HostConnection> acquired;
+    {
+        lock_guard<mutex> lock(siteMutex);
+        if (!idleConnections.empty()) {
+            acquired = move(idleConnections.back());
+            idleConnections.pop_back();
+        } else {
+            acquired.reset(new HostConnection(hostname, port, keepAlive, secure));
         }
+    }
+    acquired->setTimeout(budget.timeoutMs());
+    return acquired;
+}
 
-        // Process extracted URLs
-        LinkedList extractedUrls = extractUrls(response);
-        Node* current = extractedUrls.getHead();
+void ClientSocket::releaseConnection(unique_ptr<HostConnection> released) {
+    lock_guard<mutex> lock(siteMutex);
+    if (keepAlive && released->isSecure() == secure && (int)idleConnections.size() < budget.maxActive()) {
+        idleConnections.push_back(move(released));
+    }
+}
 
-        while (current) {
-            // Process internal links
-            if (current->url.empty() || current->url == hostname) {
-                if (!discoveredPages[current->metadata]) {
-                    pendingPages.add(current->metadata, "");
-                    discoveredPages[current->metadata] = true;
-                }
-            }
-            // Process external links
-            else {
-                if (!discoveredLinkedSites[current->url]) {
-                    discoveredLinkedSites[current->url] = true;
-                    stats.linkedSites.add(current->url, "");
-                }
+// Each pipelined request still spends a token, so pipelining only kicks in
+// when the host's burst leaves room; it hides round trips, not the rate
+vector<string> ClientSocket::pipelineBatch(const HostConnection& connection) {
+    vector<string> paths;
+    {
+        lock_guard<mutex> lock(siteMutex);
+        if (!pipelining) return paths;
+    }
+    if (!connection.canPipeline()) return paths;
+
+    // Pages can vanish between the count and takePage() (robots.txt, page
+    // limit, another worker); their tokens go back to the bucket
+    int granted = budget.takeExtra(min(pipelineDepth - 1, pagesAvailable()));
+    string path;
+    while ((int)paths.size() < granted && takePage(path)) paths.push_back(path);
+    budget.refund(granted - (int)paths.size());
+    return paths;
+}
+
+void ClientSocket::returnUnanswered(HostConnection& connection) {
+    vector<string> unanswered = connection.takeUnanswered();
+    lock_guard<mutex> lock(siteMutex);
+    if (connection.pipelineBroken()) pipelining = false;
+
+    pagesInFlight -= (int)unanswered.size();
+    for (const string& path : unanswered) pendingPages.push(path);
+}
+
+void ClientSocket::completePage(HostConnection& fetched) {
+    lock_guard<mutex> lock(siteMutex);
+    pagesInFlight--;
+    if (fetched.openedConnection()) stats.connectionsOpened++;
+    if (fetched.servedFromCache()) stats.pagesNotModified++;
+    if (fetched.wasPipelined()) stats.pagesPipelined++;
+    stats.bytesOnWire += fetched.getResponse().bytesOnWire();
+    stats.bytesDecoded += fetched.getResponse().bytesDecoded();
+
+    Metrics& metrics = Metrics::shared();
+    for (int i = 0; i < pageMetricCount; i++) {
+        int64_t micros = fetched.phaseTime((Metric)i);
+        if (micros < 0) continue;
+        stats.timings.phases[i].record((uint64_t)micros);
+        metrics.record((Metric)i, (uint64_t)micros);
+    }
+
+    int status = fetched.getResponse().statusCode();
+    bool throttled = fetched.outcome() == FetchOutcome::Fetched && (status == 429 || status == 503);
+    if (fetched.outcome() == FetchOutcome::Failed || throttled) {
+        budget.recordFailure(throttled ? atoi(fetched.getResponse().header("Retry-After").c_str()) : 0);
+    } else if (fetched.getResponseTime() >= 0) {
+        budget.recordResponse(fetched.getResponseTime());
+    }
+
+    if (robotsState == RobotsState::Fetching && fetched.getPath() == RobotsRules::path) {
+        finishRobots(fetched);
+        return;
+    }
+
+    // Adaptive budgets retry a throttled page once, after backing off
+    if (throttled && budget.adaptive()) {
+        stats.pagesThrottled++;
+        if (throttledPages.insert(fingerprint64(fetched.getPath()))) pendingPages.push(fetched.getPath());
+        return;
+    }
+
+    switch (fetched.outcome()) {
+    case FetchOutcome::Fetched:
+        break;
+    case FetchOutcome::Redirected:
+        stats.pagesRedirected++;
+        queueRedirect(fetched);
+        return;
+    case FetchOutcome::NotHtml:
+        stats.pagesNotHtml++;
+        return;
+    case FetchOutcome::TooLarge:
+        stats.pagesTooLarge++;
+        return;
+    case FetchOutcome::Failed:
+        stats.numberOfPagesFailed++;
+        return;
+    }
+
+    CrawlJournal& journal = CrawlJournal::shared();
+    recordVisit(fetched.getPath(), fetched.getResponseTime());
+    journal.pageVisited(hostname, fetched.getPath(), fetched.getResponseTime());
+
+    // Process URLs extracted while the page was received
+    const UrlList& links = fetched.getLinks();
+
+    for (const UrlRecord& link : links) {
+        // Process internal links
+        if (link.host.length == 0 || links.hostEquals(link, hostname)) {
+            string path = canonicalizePath(links.path(link));
+            if (discoveredPages.insertUrl(hostname + path)) {
+                pendingPages.push(path);
+                journal.pageQueued(hostname, path);
+            } else {
+                pendingPages.addInlink(path);
             }
-            current = current->next;
+        }
+        // Process external links
+        else {
+            string_view site = links.host(link);
+            if (addLinkedSite(site)) journal.linkedSite(hostname, site);
         }
     }
 
-    // Calculate average response time
+    // Linked sites seen with https:// are crawled over TLS once their turn comes
+    TlsContext& tls = TlsContext::shared();
+    if (tls.enabled()) {
+        const UrlList& secureHosts = fetched.getSecureHosts();
+        for (const UrlRecord& link : secureHosts) {
+            if (!secureHosts.hostEquals(link, hostname)) tls.markSecure(secureHosts.host(link));
+        }
+    }
+}
+
+// A missing robots.txt (4xx) allows everything; a failing one (5xx, no
+// response) disallows everything, as RFC 9309 asks. A failed fetch also
+// counts as a failed page. A redirect to https on the same host switches
+// the site to TLS and fetches robots.txt again, up to maxRobotsRedirects
+// times; any other redirect is not followed and allows everything.
+void ClientSocket::finishRobots(const HostConnection& fetched) {
+    int status = fetched.getResponse().statusCode();
+    if (fetched.outcome() == FetchOutcome::Redirected && robotsRedirects < maxRobotsRedirects) {
+        string host, path;
+        bool secureTarget = secure;
+        resolveLocation(fetched.redirectTarget(), fetched.getPath(), host, path, secureTarget);
+        if ((host.empty() || host == hostname) && secureTarget && !secure && switchToTls()) {
+            robotsRedirects++;
+            robotsState = RobotsState::Unchecked;
+            return;
+        }
+    }
+
+    if (fetched.outcome() == FetchOutcome::Fetched && status >= 200 && status < 300) {
+        robots = RobotsRules::parse(fetched.getBody(), RobotsCache::shared().userAgent());
+    } else if (fetched.outcome() == FetchOutcome::Redirected || (status >= 400 && status < 500)) {
+        robots = RobotsRules::allowAll();
+    } else {
+        if (fetched.outcome() == FetchOutcome::Failed && status == 0) stats.numberOfPagesFailed++;
+        robots = RobotsRules::disallowAll();
+    }
+
+    RobotsCache::shared().store(hostname, robots);
+    robotsState = RobotsState::Ready;
+    applyCrawlDelay();
+}
+
+// Crawl-delay may only slow the host down from the configured rate
+void ClientSocket::applyCrawlDelay() {
+    if (robots->crawlDelay() > 0) budget.limitRate(1.0 / robots->crawlDelay());
+}
+
+// A redirect within the site queues its target like a discovered link;
+// one to another host adds that host to the linked sites
+void ClientSocket::queueRedirect(const HostConnection& fetched) {
+    string host, path;
+    bool secureTarget = secure;
+    resolveLocation(fetched.redirectTarget(), fetched.getPath(), host, path, secureTarget);
+    CrawlJournal& journal = CrawlJournal::shared();
+
+    if (host.empty() || host == hostname) {
+        // The usual http -> https upgrade points at the page just fetched,
+        // so it is queued again even though it was already discovered
+        if (secureTarget && !secure && switchToTls()) {
+            discoveredPages.insertUrl(hostname + path);
+            pendingPages.push(path);
+            journal.pageQueued(hostname, path);
+            return;
+        }
+        if (verifyType(path) && discoveredPages.insertUrl(hostname + path)) {
+            pendingPages.push(path);
+            journal.pageQueued(hostname, path);
+        }
+    } else if (verifyUrl(host + path) && addLinkedSite(host)) {
+        if (secureTarget) TlsContext::shared().markSecure(host);
+        journal.linkedSite(hostname, host);
+    }
+}
+
+// Repeated links to a site count as its in-links, which rank the linked
+// sites when the crawler can only follow some of them
+bool ClientSocket::addLinkedSite(string_view site) {
+    auto slot = linkedSiteSlots.emplace(urlFingerprint(site), stats.linkedSiteInlinks.size());
+    if (!slot.second) {
+        stats.linkedSiteInlinks[slot.first->second]++;
+        return false;
+    }
+    stats.linkedSites.add(site, "");
+    stats.linkedSiteInlinks.push_back(1);
+    return true;
+}
+
+bool ClientSocket::switchToTls() {
+    if (!TlsContext::shared().enabled()) return false;
+    TlsContext::shared().markSecure(hostname);
+    secure = true;
+    port = 443;
+    idleConnections.clear();
+    return true;
+}
+
+bool ClientSocket::schemeChanged(const HostConnection& connection) const {
+    lock_guard<mutex> lock(siteMutex);
+    return connection.isSecure() != secure;
+}
+
+void ClientSocket::recordVisit(string_view path, double responseTime) {
+    stats.visitedPages.add(hostname, path, 0, responseTime);
+    responseTimeSum += responseTime;
+
+    // Update response time statistics
+    if (stats.minResponseTime < 0 || responseTime < stats.minResponseTime) {
+        stats.minResponseTime = responseTime;
+    }
+    if (stats.maxResponseTime < 0 || responseTime > stats.maxResponseTime) {
+        stats.maxResponseTime = responseTime;
+    }
+}
+
+// Pages visited before the checkpoint keep their statistics; the rest of
+// the pages queued back then are fetched again, in their original order
+void ClientSocket::restore(const CrawlJournal::RestoredSite& saved) {
+    lock_guard<mutex> lock(siteMutex);
+    pendingPages.clear();
+
+    for (const auto& page : saved.pages) {
+        discoveredPages.insertUrl(hostname + page.path);
+        if (page.visited) recordVisit(page.path, page.responseTime);
+        else pendingPages.push(page.path);
+    }
+    for (const string& linked : saved.linkedSites) {
+        addLinkedSite(linked);
+    }
+}
+
+void ClientSocket::finishSite() {
+    lock_guard<mutex> lock(siteMutex);
+    idleConnections.clear();
+    pendingPages.clear();            // Pages left over by the page limit
+
     if (!stats.visitedPages.empty()) {
-        double totalTime = 0;
-        for (const auto& page : stats.visitedPages) {
-            totalTime += page.responseTime;
+        stats.averageResponseTime = responseTimeSum / stats.visitedPages.size();
+    }
+}
+
+double ClientSocket::currentResponseTime() const {
+    lock_guard<mutex> lock(siteMutex);
+    return stats.visitedPages.empty() ? -1 : responseTimeSum / stats.visitedPages.size();
+}
+
+SiteStats ClientSocket::takeStats() {
+    lock_guard<mutex> lock(siteMutex);
+    return move(stats);
+}
+
+SOCKET ClientSocket::handle() const {
+    return (phase == Phase::Fetching && connection) ? connection->handle() : INVALID_SOCKET;
+}
+
+steady_clock::time_point ClientSocket::wakeTime() const {
+    return (phase == Phase::Fetching && connection) ? connection->wakeTime() : deadline;
+}
+
+IoWait ClientSocket::advance() {
+    while (true) {
+        switch (phase) {
+        case Phase::NextPage: {
+            if (!takePage(currentPath)) {
+                connection.reset();
+                finishSite();
+                phase = Phase::Finished;
+                return IoWait::Done;
+            }
+            if (!connection) connection = acquireConnection();
+            phase = Phase::Waiting;
+            break;
+        }
+
+        case Phase::Waiting:
+            // The budget paces requests to this host instead of a fixed sleep
+            if (!budget.tryAcquire(deadline)) return IoWait::Timer;
+            connection->setTimeout(budget.timeoutMs());
+            connection->setAsyncDns(asyncDns);
+            connection->start(currentPath, pipelineBatch(*connection));
+            phase = Phase::Fetching;
+            break;
+
+        case Phase::Fetching: {
+            IoWait wait = connection->advance();
+            if (wait != IoWait::Done) return wait;
+            completePage(*connection);
+            if (connection->startNext()) break;
+
+            budget.release();
+            returnUnanswered(*connection);
+            if (schemeChanged(*connection)) connection.reset();
+            phase = Phase::NextPage;
+            break;
+        }
+
+        case Phase::Finished:
+            return IoWait::Done;
         }
-        stats.averageResponseTime = totalTime / stats.visitedPages.size();
     }
+}
+
+// Blocking driver: waits on the single socket between state machine steps
+SiteStats ClientSocket::startDiscovering() {
+    IoWait wait;
 
-    return stats;
-}
\ No newline at end of file
+    while ((wait = advance()) != IoWait::Done) {
+        waitForSocket(handle(), wait, wakeTime());
+    }
+
+    return takeStats();
+}
@@ -9,9 +9,35 @@
  *
  *  Key Features:
  *  - Establishes socket connections for HTTP requests.
- *  - Crawls websites, extracts internal and external links.
+ *  - Crawls websites, extracts internal and external links while the page
+ *    is still being received.
  *  - Tracks response times, discovered pages, and linked sites.
- *  - Supports Winsock initialization and cleanup.
+ *  - Reuses HTTP/1.1 keep-alive connections across pages of a host, and
+ *    pipelines batches of requests on them for hosts that handle it.
+ *  - Resolves hostnames through the shared DnsCache.
+ *  - Fetches HTTPS sites over TLS with per-host session resumption (see
+ *    tlsTransport.h), switching a site to HTTPS when it redirects there.
+ *  - Requests compressed pages and decodes them while they stream in.
+ *  - Checks status and headers before reading a body: redirects are queued
+ *    as new pages, and non-HTML or oversized responses are abandoned.
+ *  - Revalidates previously fetched pages with conditional GETs and reuses
+ *    their cached links on 304 Not Modified (see responseCache.h).
+ *  - Resumable, non-blocking state machine so that one thread can drive
+ *    many sites at once (see ioEngine.h).
+ *  - Crawls a site's pages best first (most linked, shallow, short paths)
+ *    and counts the links to each linked site (see pageFrontier.h).
+ *  - Fetches the host's robots.txt before its first page, skips the pages
+ *    it disallows and slows down to its Crawl-delay (see robots.h).
+ *  - Adapts each host's timeout, concurrency and rate to its response times
+ *    and failures when adaptive control is on (see politeness.h).
+ *  - Page-level interface so several workers can crawl one site, limited
+ *    by the site's HostBudget (see politeness.h).
+ *  - Times every phase of a fetch (DNS, connect, TLS handshake, send, TTFB,
+ *    download, parse) into per-site and crawl-wide histograms (see metrics.h).
+ *  - Records its progress in the CrawlJournal and can be restored from it
+ *    (see crawlJournal.h).
+ *  - Portable across Winsock and POSIX sockets (see netPlatform.h); the
+ *    network library is started once per process, not per site.
  *
  *  The ClientSocket class is integral for performing web crawling tasks
  *  and gathering performance metrics for websites.
@@ -21,27 +47,29 @@
 #ifndef CLIENTSOCKET_H
 #define CLIENTSOCKET_H
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <windows.h>
+#include "netPlatform.h"
 #include <string>
 #include <map>
 #include <vector>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <unordered_map>
 #include "parser.h"
-
-#ifdef _MSC_VER
-#pragma comment(lib, "ws2_32.lib")
-#endif
+#include "httpResponse.h"
+#include "politeness.h"
+#include "urlSet.h"
+#include "pageFrontier.h"
+#include "crawlJournal.h"
+#include "responseCache.h"
+#include "tlsTransport.h"
+#include "metrics.h"
+#include "robots.h"
+#include "dnsCache.h"
 
 using namespace std;
 
-// Structure to store individual page statistics
-struct PageStats {
-    string url;
-    double responseTime;
-    PageStats(string u, double rt) : url(u), responseTime(rt) {}
-};
-
 // Struct to store statistics about a website
 struct SiteStats {
     string hostname;                  // Hostname or base URL of the website being crawled
@@ -49,33 +77,262 @@ struct SiteStats {
     double minResponseTime = -1;      // The minimum response time encountered
     double maxResponseTime = -1;      // The maximum response time encountered
     int numberOfPagesFailed = 0;      // Number of pages that failed to be discovered
-    LinkedList linkedSites;           // A linked list to store linked sites
-    LinkedList discoveredPages;       // A linked list to store discovered pages
-    vector<PageStats> visitedPages;   // Vector to store visited pages with response times
+    int connectionsOpened = 0;        // Number of TCP connections opened to the host
+    int pagesNotModified = 0;         // Pages answered 304 and served from the response cache
+    int pagesRedirected = 0;          // Pages answered with a redirect (target queued instead)
+    int pagesNotHtml = 0;             // Pages abandoned because they are not HTML
+    int pagesTooLarge = 0;            // Pages abandoned for exceeding the page size limit
+    int pagesPipelined = 0;           // Pages requested behind another one on the same connection
+    int pagesDisallowed = 0;          // Pages skipped because robots.txt disallows them
+    int pagesThrottled = 0;           // Pages answered 429/503 under adaptive control (retried once)
+    size_t bytesOnWire = 0;           // Response bytes received, headers and encoded bodies
+    size_t bytesDecoded = 0;          // Page body bytes after decompression
+    PageTimings timings;              // Latency of each fetch phase over the site's pages
+    UrlList linkedSites;              // Linked sites (host only)
+    vector<int> linkedSiteInlinks;    // Links seen to each linked site, in linkedSites order
+    UrlList visitedPages;             // Visited pages with their response times
+};
+
+// What a resumable state machine is waiting for after advance() returns
+enum class IoWait {
+    Read,       // The socket must become readable
+    Write,      // The socket must become writable (connect or send pending)
+    Timer,      // Nothing to do until wakeTime() (politeness budget)
+    Done        // The page (HostConnection) or site (ClientSocket) is finished
 };
 
+// How a fetch ended once HostConnection::advance() returned Done
+enum class FetchOutcome {
+    Fetched,    // Complete response; its links were extracted
+    Failed,     // Connection, protocol or timeout error
+    Redirected, // 3xx with a Location; redirectTarget() is to be crawled instead
+    NotHtml,    // Body skipped after the headers: Content-Type is not HTML
+    TooLarge    // Abandoned: the body exceeds the page size limit
+};
+
+// Blocks until sock is ready for the given wait, or until deadline passes.
+// A Timer wait simply sleeps until the deadline.
+void waitForSocket(SOCKET sock, IoWait wait, chrono::steady_clock::time_point deadline);
+
+// ----------------------------------------------------------------------------
+// HostConnection: one (keep-alive) connection fetching one page at a time
+// ----------------------------------------------------------------------------
+class HostConnection {
+public:
+    HostConnection(const string& hostname, int port, bool keepAlive, bool secure = false);
+    ~HostConnection();
+
+    // Pages whose body (decoded) exceeds maxPageBytes are abandoned; 0 allows any size.
+    // A non-empty userAgent is sent as the User-Agent header.
+    static void configure(size_t maxPageBytes, const string& userAgent = string());
+
+    // Starts fetching path, reusing the open connection when possible.
+    // Requests for the pipelined paths go out right behind it on the same
+    // connection; their responses are read in turn through startNext().
+    void start(const string& path, const vector<string>& pipelined = vector<string>());
+
+    // Once advance() returned Done, moves on to the next pipelined page.
+    // Returns false when none is left or the connection was lost.
+    bool startNext();
+
+    // Pipelined pages whose responses will not arrive (the connection was
+    // closed); the caller must fetch them again
+    vector<string> takeUnanswered();
+
+    // True when the server dropped pipelined requests it had accepted
+    bool pipelineBroken() const { return brokenPipeline; }
+
+    // The connection is open and has already answered a request, so the
+    // server is known to keep HTTP/1.1 connections alive
+    bool canPipeline() const { return sock != INVALID_SOCKET && requestsOnSocket > 0; }
+
+    // Runs the connect/send/recv state machine on the non-blocking socket
+    // until it would block. Returns Read or Write while the fetch is in
+    // progress and Done once it has succeeded or failed.
+    IoWait advance();
+
+    // Drives the current fetch to completion on the calling thread
+    bool wait();
+
+    // Starts and drives a fetch to completion on the calling thread
+    bool fetch(const string& path);
+
+    bool succeeded() const { return success; }
+    FetchOutcome outcome() const { return result; }
+    const string& redirectTarget() const { return location; }   // Location header of a redirect
+    bool openedConnection() const { return opened; }
+    bool servedFromCache() const { return fromCache; }    // 304 answered with cached links
+    bool wasPipelined() const { return pipelinedPage; }
+    bool isSecure() const { return secure; }
+    const HttpResponse& getResponse() const { return response; }
+    UrlList& getLinks() { return extractor.links(); }    // Links streamed out of the body
+    const string& getBody() const { return body; }       // Raw body, kept for robots.txt only
+    const UrlList& getSecureHosts() const { return extractor.secureHosts(); }   // Hosts linked over https
+    double getResponseTime() const { return responseTime; }
+    int64_t phaseTime(Metric metric) const { return phaseMicros[(int)metric]; }  // us, -1 when skipped
+    const string& getPath() const { return path; }
+    void setTimeout(int milliseconds) { timeoutMs = milliseconds; }   // Applies from the next I/O step
+    void setAsyncDns(bool enabled) { asyncDns = enabled; }   // Poll lookups on the resolver threads (event loops)
+    SOCKET handle() const { return sock; }
+    chrono::steady_clock::time_point wakeTime() const { return deadline; }
+
+private:
+    enum class Phase { Idle, Resolving, Connecting, Handshaking, Sending, Receiving };
+
+    // A request sent (or to be sent) behind the current one
+    struct PipelinedRequest {
+        string path;
+        bool haveCached;
+        ResponseCache::Entry cached;
+    };
+
+    string hostname;                 // Host the connection belongs to
+    int port;                        // The port to connect to (default is 80 for HTTP)
+    bool keepAlive;                  // Reuse the connection across pages when the server allows it
+    bool secure;                     // HTTPS: the socket carries a TLS stream
+    SOCKET sock;                     // The socket used for communication with the server
+    TlsStream tls;                   // TLS state of sock when secure
+    int requestsOnSocket;            // Requests already answered on the current connection
+    bool asyncDns;                   // Resolving returns Timer instead of waiting for the resolver
+    shared_ptr<DnsCache::Lookup> dnsLookup;   // Lookup being polled in the Resolving phase
+
+    Phase phase;
+    string path;                     // Path of the page being fetched
+    string request;                  // Serialized HTTP request
+    size_t bytesSent;                // Bytes of request already sent
+    bool reusedConnection;           // Request went out on a kept-alive connection
+    bool retried;                    // Request already retried on a fresh connection
+    bool opened;                     // This fetch opened a new TCP connection
+    bool success;                    // Outcome once advance() returned Done
+    FetchOutcome result;             // Why the fetch ended
+    string location;                 // Redirect target
+    bool haveCached;                 // cached holds a response cache entry for path
+    bool fromCache;                  // Links of this fetch came from the cache
+    ResponseCache::Entry cached;     // Validators and links of the previous fetch
+    deque<PipelinedRequest> pipelined;   // Requests queued behind the current one, in order
+    string leftover;                 // Bytes received past the current response
+    bool brokenPipeline;             // Pipelined requests were lost on this connection
+    bool pipelinedPage;              // The current page was requested behind another one
+    bool rawBody;                    // robots.txt: the body is kept as is instead of parsed for links
+    bool discardBody;                // Unwanted short body, read only to keep the connection
+    string body;                     // Decoded body when rawBody
+    int timeoutMs;                   // Connect, send and receive timeout
+    HttpResponse response;           // Incremental parser for the response
+    LinkExtractor extractor;         // Consumes the body chunk by chunk as it arrives
+    double responseTime;             // Time to first byte
+    int64_t phaseMicros[pageMetricCount];          // Duration of each fetch phase, -1 when skipped
+    chrono::steady_clock::time_point phaseStart;   // Start of the connect, handshake or send phase
+    chrono::steady_clock::time_point requestSent;  // Request fully sent (TTFB starts here)
+    chrono::steady_clock::time_point firstByte;    // First response byte (download starts here)
+    chrono::steady_clock::time_point deadline;     // Current I/O timeout
+    chrono::high_resolution_clock::time_point requestStart;
+
+    bool createSocket();
+    bool connectToHost(const SOCKADDR_IN& address);
+    void closeConnection();
+    string createHttpRequest(string host, string path, const ResponseCache::Entry* validators);
+    void resetPage(const string& pagePath);
+    int sendBytes(const char* data, int length, IoWait& wait);
+    int recvBytes(char* buffer, int length, IoWait& wait);
+    void receive(const char* data, size_t length);
+    bool beginRequest();
+    void connectionFailed();
+    void finish(bool ok);
+    void updateCache();
+    bool acceptHeaders();
+    bool drainBody(bool allowChunked);
+    void receiveBody(const char* data, size_t length);
+
+    static size_t maxPageBytes;      // Page size limit, 0 for none
+    static string userAgent;         // User-Agent header, none when empty
+
+    HostConnection(const HostConnection&) = delete;
+    HostConnection& operator=(const HostConnection&) = delete;
+};
+
+// ----------------------------------------------------------------------------
+// ClientSocket: crawl state of one website
+// ----------------------------------------------------------------------------
 class ClientSocket {
 public:
-    ClientSocket(string hostname, int port = 80, int pagesLimit = -1, int crawlDelay = 1000);
-    ~ClientSocket();
+    // crawlDelay sets the host's sustained request rate (one request per
+    // crawlDelay ms); burst and maxConnections let requests overlap within it.
+    // Pending pages beyond pageMemory bytes are spilled to disk. Up to
+    // pipelineDepth requests are pipelined on a kept-alive connection.
+    // Port 443 crawls the site over HTTPS.
+    ClientSocket(string hostname, int port = 80, int pagesLimit = -1, int crawlDelay = 1000, bool keepAlive = true,
+                 int maxConnections = 1, double burst = 1, size_t pageMemory = 0, int pipelineDepth = 1);
+
+    // Crawls the site on the calling thread and hands over (moves out) its
+    // statistics; getStats() is empty afterwards
     SiteStats startDiscovering();
 
+    // Resumable interface used by event-driven engines. advance() runs the
+    // site's state machine (one connection, pages in turn, paced by the
+    // budget) until it would block, and reports what it is waiting for. It
+    // must be called again when handle() is ready or once wakeTime() passed.
+    IoWait advance();
+    SOCKET handle() const;
+    chrono::steady_clock::time_point wakeTime() const;
+    void setAsyncDns(bool enabled) { asyncDns = enabled; }   // Event loop: never wait for the resolver
+    const SiteStats& getStats() const { return stats; }
+    SiteStats takeStats();                        // Moves the statistics out once the site is done
+    double currentResponseTime() const;           // Average over the pages visited so far, -1 before any
+
+    // Page-level interface for schedulers that spread one site over several
+    // workers. All of these are thread-safe.
+    bool takePage(string& path);                  // Reserves the next pending page
+    void completePage(HostConnection& fetched);   // Records a finished fetch and its links
+    vector<string> pipelineBatch(const HostConnection& connection);  // Pages to pipeline behind a taken one
+    void returnUnanswered(HostConnection& connection);  // Requeues pipelined pages left unanswered
+    bool isFinished() const;                      // No page left to fetch or in flight
+    int pagesAvailable() const;                   // Pages takePage() could hand out right now
+    void finishSite();                            // Computes the final statistics
+    void restore(const CrawlJournal::RestoredSite& saved);   // Continues from a checkpoint
+    unique_ptr<HostConnection> acquireConnection();
+    void releaseConnection(unique_ptr<HostConnection> connection);
+    HostBudget& getBudget() { return budget; }
+
 private:
+    enum class Phase { NextPage, Waiting, Fetching, Finished };
+    enum class RobotsState { Unchecked, Fetching, Ready };
+
     string hostname;                  // The hostname or base URL of the website to be crawled
     int port;                        // The port to connect to (default is 80 for HTTP)
     int pagesLimit;                  // The maximum number of pages to crawl
-    int crawlDelay;                  // The delay between requests (in milliseconds)
-    SOCKET sock;                     // The socket used for communication with the server
+    bool keepAlive;                  // Reuse connections across pages when the server allows it
+    bool secure;                     // Crawled over HTTPS (port 443 or after a redirect to https)
+    int pipelineDepth;               // Requests in flight per connection; 1 disables pipelining
+    bool asyncDns;                   // Connections resolve on the resolver threads (see setAsyncDns)
+    HostBudget budget;               // Concurrency and request rate allowed for this host
 
-    LinkedList pendingPages;         // A linked list to keep track of pages to be crawled
-    map<string, bool> discoveredPages;   // A map to store pages already discovered
-    map<string, bool> discoveredLinkedSites; // A map to store external linked sites
+    mutable mutex siteMutex;         // Guards everything below for the page-level interface
+    PageFrontier pendingPages;       // Paths of pages still to be crawled, best first
+    UrlFingerprintSet discoveredPages;       // Fingerprints of pages already discovered
+    UrlFingerprintSet throttledPages;        // Fingerprints of pages already retried after a 429/503
+    unordered_map<uint64_t, size_t> linkedSiteSlots;  // Fingerprint of a linked site -> its linkedSites index
+    SiteStats stats;                 // Statistics collected so far
+    int pagesInFlight;               // Pages taken but not yet completed
+    double responseTimeSum;          // Sum of the visited pages' response times
+    bool pipelining;                 // Cleared once the host mishandled a pipelined batch
+    vector<unique_ptr<HostConnection>> idleConnections;  // Kept-alive connections ready for reuse
+    RobotsState robotsState;         // Ready straight away when robots.txt is not honored
+    shared_ptr<const RobotsRules> robots;    // Rules pages are checked against, null when not honored
+    int robotsRedirects;             // Redirects of robots.txt followed so far
 
-    bool initializeWinsock();
-    bool createSocket();
-    bool connectToHost();
-    void cleanup();
-    string createHttpRequest(string host, string path);
+    // State of the single-connection resumable interface
+    Phase phase;
+    string currentPath;              // Page being fetched by advance()
+    unique_ptr<HostConnection> connection;
+    chrono::steady_clock::time_point deadline;   // When the budget allows the next page
+
+    void recordVisit(string_view path, double responseTime);   // Caller holds siteMutex
+    void queueRedirect(const HostConnection& fetched);         // Caller holds siteMutex
+    bool addLinkedSite(string_view site);                      // Caller holds siteMutex; true when new
+    bool switchToTls();                                        // Caller holds siteMutex
+    void finishRobots(const HostConnection& fetched);          // Caller holds siteMutex
+    void applyCrawlDelay();
+    bool schemeChanged(const HostConnection& connection) const; // Connection predates switchToTls()
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,494 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  Cluster Implementation
+ * ----------------------------------------------------------------------------
+ *  Frames on every connection are one type byte, a u32 payload length and
+ *  the payload, in native byte order (the nodes of a crawl run the same
+ *  build):
+ *    'L' links  (worker -> worker): u32 site count, u32 uncompressed
+ *               length, then zlib data of per site u16 length, hostname,
+ *               i32 depth, u8 secure
+ *    'S' status (worker -> coordinator): u32 worker, u8 idle, u64 sites
+ *               sent, u64 sites received
+ *    'X' stop   (coordinator -> worker): no payload
+ *  Connections are blocking and each has its own reader thread; a crawl
+ *  has a handful of nodes, not thousands.
+ *
+ *  The coordinator compares consecutive rounds, each holding a fresh report
+ *  from every worker. A site in transit shows up as sent but not received,
+ *  and work done between two rounds changes some counter, so two identical,
+ *  balanced and all-idle rounds mean nothing is left anywhere.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "cluster.h"
+#include "dnsCache.h"
+#include "urlSet.h"
+#include <zlib.h>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std::chrono;
+
+namespace {
+
+const char linksFrame = 'L';
+const char statusFrame = 'S';
+const char stopFrame = 'X';
+const milliseconds statusInterval(100);
+const milliseconds reconnectDelay(500);
+const uint32_t maxPayload = 64 << 20;
+
+// SplitMix64 finalizer, spreads (host, worker) over the 64-bit range
+uint64_t mix64(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+template<typename T>
+void put(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+bool get(const string& in, size_t& offset, T& value) {
+    if (in.size() - offset < sizeof(value)) return false;
+    memcpy(&value, in.data() + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+}
+
+bool sendAll(SOCKET sock, const char* data, size_t length) {
+    while (length > 0) {
+        int sentBytes = send(sock, data, (int)min<size_t>(length, 1 << 20), 0);
+        if (sentBytes <= 0) return false;
+        data += sentBytes;
+        length -= sentBytes;
+    }
+    return true;
+}
+
+bool recvAll(SOCKET sock, char* data, size_t length) {
+    while (length > 0) {
+        int receivedBytes = recv(sock, data, (int)min<size_t>(length, 1 << 20), 0);
+        if (receivedBytes <= 0) return false;
+        data += receivedBytes;
+        length -= receivedBytes;
+    }
+    return true;
+}
+
+bool sendFrame(SOCKET sock, char type, const string& payload) {
+    string frame(1, type);
+    put<uint32_t>(frame, (uint32_t)payload.size());
+    frame += payload;
+    return sendAll(sock, frame.data(), frame.size());
+}
+
+bool recvFrame(SOCKET sock, char& type, string& payload) {
+    char header[5];
+    if (!recvAll(sock, header, sizeof(header))) return false;
+    type = header[0];
+    uint32_t length;
+    memcpy(&length, header + 1, sizeof(length));
+    if (length > maxPayload) return false;
+    payload.resize(length);
+    return length == 0 || recvAll(sock, &payload[0], length);
+}
+
+SOCKET connectTo(const Cluster::Node& node) {
+    SOCKADDR_IN address;
+    if (!DnsCache::shared().resolve(node.host, address)) return INVALID_SOCKET;
+    address.sin_family = AF_INET;
+    address.sin_port = htons(node.port);
+
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+    if (connect(sock, (SOCKADDR*)&address, sizeof(address)) == SOCKET_ERROR) {
+        closeSocket(sock);
+        return INVALID_SOCKET;
+    }
+    int noDelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+    return sock;
+}
+
+SOCKET listenOn(int port) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    SOCKADDR_IN address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (::bind(sock, (SOCKADDR*)&address, sizeof(address)) == SOCKET_ERROR || listen(sock, SOMAXCONN) == SOCKET_ERROR) {
+        closeSocket(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+void dropSocket(SOCKET& sock) {
+    if (sock == INVALID_SOCKET) return;
+    shutdown(sock, SD_BOTH);
+    closeSocket(sock);
+    sock = INVALID_SOCKET;
+}
+
+}
+
+Cluster& Cluster::shared() {
+    static Cluster cluster;
+    return cluster;
+}
+
+Cluster::Cluster()
+    : self(-1), batchSites(256), flushMs(50), queued(0), sent(0), received(0), wireBytes(0), rawBytes(0),
+      finished(false), stopping(false), listener(INVALID_SOCKET), coordinatorSocket(INVALID_SOCKET),
+      coordinatorLost(false) {}
+
+Cluster::Node Cluster::parseNode(const string& address) {
+    size_t colon = address.rfind(':');
+    Node node;
+    if (colon != string::npos && colon > 0) {
+        node.host = address.substr(0, colon);
+        node.port = atoi(address.c_str() + colon + 1);
+    }
+    if (node.port <= 0 || node.port > 65535) throw runtime_error("Cluster address " + address + " must be host:port");
+    return node;
+}
+
+void Cluster::configure(const vector<Node>& clusterNodes, int index, size_t sites, int milliseconds) {
+    nodes = clusterNodes;
+    self = index;
+    batchSites = max<size_t>(1, sites);
+    flushMs = max(0, milliseconds);
+}
+
+// Rendezvous hashing: the worker with the highest score for the host owns
+// it, so removing a worker moves only the hosts it owned
+int Cluster::owner(string_view hostname) const {
+    uint64_t fingerprint = fingerprint64(hostname);
+    int best = 0;
+    uint64_t bestScore = 0;
+    for (size_t node = 0; node < nodes.size(); node++) {
+        uint64_t score = mix64(fingerprint ^ mix64(node + 1));
+        if (node == 0 || score > bestScore) {
+            best = (int)node;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+// ----------------------------------------------------------------------------
+// Worker
+// ----------------------------------------------------------------------------
+void Cluster::startWorker(const Node& coordinator, SiteHandler siteHandler, IdleCheck idle, StopHandler stopHandler) {
+    coordinatorNode = coordinator;
+    onSite = move(siteHandler);
+    idleCheck = move(idle);
+    onStop = move(stopHandler);
+    outbound.assign(nodes.size(), Outbound());
+    peerSockets.assign(nodes.size(), INVALID_SOCKET);
+
+    listener = listenOn(nodes[self].port);
+    if (listener == INVALID_SOCKET) {
+        throw runtime_error("Cannot listen on cluster port " + to_string(nodes[self].port));
+    }
+    acceptor = thread(&Cluster::acceptLoop, this, false);
+    exchange = thread(&Cluster::exchangeLoop, this);
+}
+
+void Cluster::forward(string_view hostname, int depth, bool secure) {
+    int node = owner(hostname);
+    bool full;
+    {
+        lock_guard<mutex> lock(outboundMutex);
+        Outbound& batch = outbound[node];
+        if (batch.count == 0) batch.oldest = steady_clock::now();
+        uint16_t length = (uint16_t)min<size_t>(hostname.size(), 0xFFFF);
+        put<uint16_t>(batch.records, length);
+        batch.records.append(hostname.data(), length);
+        put<int32_t>(batch.records, depth);
+        put<uint8_t>(batch.records, secure ? 1 : 0);
+        batch.count++;
+        full = batch.count >= batchSites;
+    }
+    queued++;
+    if (full) outboundSignal.notify_one();
+}
+
+void Cluster::acceptLoop(bool coordinator) {
+    while (true) {
+        SOCKET sock = accept(listener, NULL, NULL);
+        if (sock == INVALID_SOCKET) return;
+        lock_guard<mutex> lock(connectionMutex);
+        if (stopping) {
+            closeSocket(sock);
+            return;
+        }
+        inbound.push_back(sock);
+        if (coordinator) readers.emplace_back(&Cluster::readWorker, this, sock);
+        else readers.emplace_back(&Cluster::readPeer, this, sock);
+    }
+}
+
+void Cluster::readPeer(SOCKET sock) {
+    char type;
+    string payload, records;
+    while (recvFrame(sock, type, payload)) {
+        if (type != linksFrame) continue;
+
+        size_t offset = 0;
+        uint32_t count, rawLength;
+        if (!get(payload, offset, count) || !get(payload, offset, rawLength) || rawLength > maxPayload) break;
+        records.resize(rawLength);
+        uLongf length = rawLength;
+        if (uncompress((Bytef*)&records[0], &length, (const Bytef*)payload.data() + offset,
+                       (uLong)(payload.size() - offset)) != Z_OK || length != rawLength) {
+            break;
+        }
+
+        offset = 0;
+        string hostname;
+        for (uint32_t i = 0; i < count; i++) {
+            uint16_t hostLength;
+            int32_t depth;
+            uint8_t secure;
+            if (!get(records, offset, hostLength) || records.size() - offset < hostLength) break;
+            hostname.assign(records, offset, hostLength);
+            offset += hostLength;
+            if (!get(records, offset, depth) || !get(records, offset, secure)) break;
+            onSite(hostname, depth, secure != 0);
+        }
+        // Counted once the sites are in the frontier, so a status report
+        // never shows them received but not yet visible as work
+        received += count;
+    }
+}
+
+// One zlib-compressed frame per batch
+bool Cluster::sendBatch(int node, const string& records, size_t count) {
+    SOCKET& sock = peerSockets[node];
+    if (sock == INVALID_SOCKET) sock = connectTo(nodes[node]);
+    if (sock == INVALID_SOCKET) return false;
+
+    uLongf length = compressBound((uLong)records.size());
+    string payload;
+    put<uint32_t>(payload, (uint32_t)count);
+    put<uint32_t>(payload, (uint32_t)records.size());
+    size_t header = payload.size();
+    payload.resize(header + length);
+    compress2((Bytef*)&payload[header], &length, (const Bytef*)records.data(), (uLong)records.size(), Z_BEST_SPEED);
+    payload.resize(header + length);
+
+    if (!sendFrame(sock, linksFrame, payload)) {
+        dropSocket(sock);
+        return false;
+    }
+    wireBytes += payload.size() + 5;
+    rawBytes += records.size();
+    sent += count;
+    return true;
+}
+
+// Idle only counts when the counters did not move while it was checked
+void Cluster::sendStatus() {
+    uint64_t sentBefore = sent.load();
+    uint64_t receivedBefore = received.load();
+    bool idle = queued.load() == 0 && idleCheck();
+    if (sent.load() != sentBefore || received.load() != receivedBefore) idle = false;
+
+    string payload;
+    put<uint32_t>(payload, (uint32_t)self);
+    put<uint8_t>(payload, idle ? 1 : 0);
+    put<uint64_t>(payload, sentBefore);
+    put<uint64_t>(payload, receivedBefore);
+    if (!sendFrame(coordinatorSocket, statusFrame, payload)) coordinatorLost = true;
+}
+
+void Cluster::exchangeLoop() {
+    auto nextStatus = steady_clock::now();
+    auto nextConnect = steady_clock::now();
+    auto retryPeers = steady_clock::now();
+
+    while (!stopping) {
+        vector<pair<int, Outbound>> due;
+        {
+            unique_lock<mutex> lock(outboundMutex);
+            outboundSignal.wait_for(lock, milliseconds(max(1, min(flushMs, (int)statusInterval.count()))));
+            auto now = steady_clock::now();
+            for (size_t node = 0; node < outbound.size() && now >= retryPeers; node++) {
+                Outbound& batch = outbound[node];
+                if (batch.count == 0) continue;
+                if (batch.count < batchSites && now - batch.oldest < milliseconds(flushMs) && !stopping) continue;
+                due.emplace_back((int)node, move(batch));
+                batch = Outbound();
+            }
+        }
+
+        // An unreachable peer keeps its sites queued, so the crawl cannot
+        // end without them
+        for (auto& batch : due) {
+            if (sendBatch(batch.first, batch.second.records, batch.second.count)) {
+                queued -= batch.second.count;
+                continue;
+            }
+            retryPeers = steady_clock::now() + reconnectDelay;
+            lock_guard<mutex> lock(outboundMutex);
+            Outbound& pending = outbound[batch.first];
+            pending.records = batch.second.records + pending.records;
+            pending.count += batch.second.count;
+            pending.oldest = batch.second.oldest;
+        }
+
+        if (coordinatorLost) {
+            dropSocket(coordinatorSocket);
+            if (control.joinable()) control.join();
+            coordinatorLost = false;
+            cerr << "Lost the cluster coordinator, reconnecting" << endl;
+        }
+        auto now = steady_clock::now();
+        if (coordinatorSocket == INVALID_SOCKET && now >= nextConnect && !finished) {
+            coordinatorSocket = connectTo(coordinatorNode);
+            if (coordinatorSocket != INVALID_SOCKET) control = thread(&Cluster::controlLoop, this);
+            else nextConnect = now + reconnectDelay;
+        }
+        if (coordinatorSocket != INVALID_SOCKET && now >= nextStatus && !finished) {
+            sendStatus();
+            nextStatus = now + statusInterval;
+        }
+    }
+}
+
+void Cluster::controlLoop() {
+    char type;
+    string payload;
+    while (recvFrame(coordinatorSocket, type, payload)) {
+        if (type == stopFrame) {
+            finished = true;
+            onStop();
+            return;
+        }
+    }
+    if (!stopping) coordinatorLost = true;
+}
+
+void Cluster::stop() {
+    if (!enabled()) return;
+    stopping = true;
+    outboundSignal.notify_all();
+    if (exchange.joinable()) exchange.join();
+
+    dropSocket(coordinatorSocket);
+    if (control.joinable()) control.join();
+    for (SOCKET& sock : peerSockets) dropSocket(sock);
+
+    dropSocket(listener);
+    if (acceptor.joinable()) acceptor.join();
+    {
+        lock_guard<mutex> lock(connectionMutex);
+        for (SOCKET sock : inbound) shutdown(sock, SD_BOTH);
+    }
+    for (thread& reader : readers) reader.join();
+    for (SOCKET sock : inbound) closeSocket(sock);
+    readers.clear();
+    inbound.clear();
+}
+
+// ----------------------------------------------------------------------------
+// Coordinator
+// ----------------------------------------------------------------------------
+void Cluster::readWorker(SOCKET sock) {
+    char type;
+    string payload;
+    while (recvFrame(sock, type, payload)) {
+        if (type != statusFrame) continue;
+        size_t offset = 0;
+        uint32_t worker;
+        uint8_t idle;
+        uint64_t workerSent, workerReceived;
+        if (!get(payload, offset, worker) || !get(payload, offset, idle) ||
+            !get(payload, offset, workerSent) || !get(payload, offset, workerReceived)) {
+            break;
+        }
+
+        lock_guard<mutex> lock(reportMutex);
+        if (worker >= reports.size()) break;
+        Report& report = reports[worker];
+        report.idle = idle != 0;
+        report.sent = workerSent;
+        report.received = workerReceived;
+        report.sequence++;
+        report.sock = sock;
+    }
+}
+
+void Cluster::runCoordinator(const Node& coordinator, int workerCount) {
+    reports.assign(workerCount, Report());
+    listener = listenOn(coordinator.port);
+    if (listener == INVALID_SOCKET) throw runtime_error("Cannot listen on cluster port " + to_string(coordinator.port));
+    acceptor = thread(&Cluster::acceptLoop, this, true);
+    cout << "Coordinating " << workerCount << " workers on port " << coordinator.port << endl;
+
+    vector<uint64_t> lastSequence(workerCount, 0);
+    vector<pair<uint64_t, uint64_t>> previous;    // Counters of the last all-idle, balanced round
+    uint64_t exchanged = 0;
+
+    while (true) {
+        this_thread::sleep_for(statusInterval);
+        lock_guard<mutex> lock(reportMutex);
+
+        bool fresh = true;
+        for (int worker = 0; worker < workerCount; worker++) {
+            fresh = fresh && reports[worker].sequence > lastSequence[worker];
+        }
+        if (!fresh) continue;
+
+        bool idle = true;
+        uint64_t totalSent = 0, totalReceived = 0;
+        vector<pair<uint64_t, uint64_t>> counters;
+        for (int worker = 0; worker < workerCount; worker++) {
+            const Report& report = reports[worker];
+            lastSequence[worker] = report.sequence;
+            idle = idle && report.idle;
+            totalSent += report.sent;
+            totalReceived += report.received;
+            counters.emplace_back(report.sent, report.received);
+        }
+
+        if (!idle || totalSent != totalReceived) {
+            previous.clear();
+            continue;
+        }
+        if (counters != previous) {
+            previous = counters;
+            continue;
+        }
+
+        exchanged = totalSent;
+        for (const Report& report : reports) sendFrame(report.sock, stopFrame, string());
+        break;
+    }
+
+    cout << "Crawl finished: " << exchanged << " sites exchanged between workers" << endl;
+
+    stopping = true;
+    dropSocket(listener);
+    if (acceptor.joinable()) acceptor.join();
+    {
+        lock_guard<mutex> lock(connectionMutex);
+        for (SOCKET sock : inbound) shutdown(sock, SD_BOTH);
+    }
+    for (thread& reader : readers) reader.join();
+    for (SOCKET sock : inbound) closeSocket(sock);
+    readers.clear();
+    inbound.clear();
+}
@@ -0,0 +1,162 @@
+/*
+* ----------------------------------------------------------------------------
+ *  Cluster Header - Distributed Crawl Across Several Nodes
+ * ----------------------------------------------------------------------------
+ *  This header defines the Cluster class, which spreads one crawl over
+ *  several crawler processes (workers), usually on different machines.
+ *  Every host is owned by exactly one worker, chosen by rendezvous hashing
+ *  of its fingerprint, so each site is crawled once however many workers
+ *  discover it. Linked sites owned by another worker are forwarded to it in
+ *  batches; a separate coordinator process only watches the workers and
+ *  ends the crawl once all of them ran out of work.
+ *
+ *  Key Features:
+ *  - Consistent ownership: adding a worker only moves the hosts it takes
+ *    over, and every worker computes owners on its own.
+ *  - Deduplication stays local: the owner's seen set decides whether a
+ *    forwarded site is new, and the sender's seen set keeps it from
+ *    forwarding the same site twice.
+ *  - Link batches are zlib-compressed and sent when they are full or after
+ *    a short delay, over one TCP connection per peer.
+ *  - Termination by counting: workers report whether they are idle and how
+ *    many sites they sent and received; the coordinator stops the crawl
+ *    when two rounds of reports agree that everyone is idle and nothing is
+ *    in transit.
+ *  - Disabled (no sockets, no threads) unless startWorker() is called.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "netPlatform.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+class Cluster {
+public:
+    struct Node {
+        string host;
+        int port = 0;
+    };
+
+    // Called for every site forwarded to this worker; secure sites are
+    // crawled over https
+    typedef function<void(const string& hostname, int depth, bool secure)> SiteHandler;
+    // True when the worker has nothing left to crawl right now
+    typedef function<bool()> IdleCheck;
+    // Called once the coordinator ended the crawl
+    typedef function<void()> StopHandler;
+
+    static Cluster& shared();
+
+    // "host:port"; throws runtime_error when malformed
+    static Node parseNode(const string& address);
+
+    // Makes this process worker self of nodes, so owner() works before the
+    // worker starts. Batches go out at batchSites sites, or flushMs after
+    // their first site.
+    void configure(const vector<Node>& nodes, int self, size_t batchSites, int flushMs);
+
+    // Joins the crawl: listens on this worker's port for peers and reports
+    // to the coordinator. Throws runtime_error when the port is taken.
+    void startWorker(const Node& coordinator, SiteHandler onSite, IdleCheck idle, StopHandler onStop);
+
+    // Runs the coordinator of a crawl with workerCount workers until they
+    // are all done; blocks the calling thread
+    void runCoordinator(const Node& coordinator, int workerCount);
+
+    // Shuts the worker's connections and threads down
+    void stop();
+
+    bool enabled() const { return self >= 0; }
+    bool running() const { return enabled() && !finished.load(); }   // The coordinator has not ended the crawl
+
+    // Index of the worker owning hostname, and whether it is this one
+    int owner(string_view hostname) const;
+    bool owns(string_view hostname) const { return !enabled() || owner(hostname) == self; }
+
+    // Queues a site owned by another worker for its next batch
+    void forward(string_view hostname, int depth, bool secure);
+
+    uint64_t sitesSent() const { return sent.load(); }
+    uint64_t sitesReceived() const { return received.load(); }
+    uint64_t bytesSent() const { return wireBytes.load(); }     // Compressed
+    uint64_t rawBytesSent() const { return rawBytes.load(); }   // Before compression
+
+    Cluster(const Cluster&) = delete;
+    Cluster& operator=(const Cluster&) = delete;
+
+private:
+    // Sites waiting for the next batch to one peer
+    struct Outbound {
+        string records;              // Encoded sites, uncompressed
+        size_t count = 0;
+        chrono::steady_clock::time_point oldest;   // When the first of them was queued
+    };
+
+    vector<Node> nodes;
+    int self;                        // This worker's index, -1 when not clustered
+    Node coordinatorNode;
+    size_t batchSites;
+    int flushMs;
+    SiteHandler onSite;
+    IdleCheck idleCheck;
+    StopHandler onStop;
+
+    mutex outboundMutex;             // Guards outbound
+    condition_variable outboundSignal;
+    vector<Outbound> outbound;       // One per node (this worker's stays empty)
+    atomic<size_t> queued;           // Sites in outbound, not yet sent
+    vector<SOCKET> peerSockets;      // Used by the exchange thread only
+
+    atomic<uint64_t> sent;           // Sites delivered to peers
+    atomic<uint64_t> received;       // Sites received from peers
+    atomic<uint64_t> wireBytes;
+    atomic<uint64_t> rawBytes;
+    atomic<bool> finished;           // The coordinator ended the crawl
+    atomic<bool> stopping;
+
+    SOCKET listener;
+    thread acceptor;
+    thread exchange;                 // Sends batches and status reports
+    SOCKET coordinatorSocket;
+    thread control;                  // Waits for the coordinator's stop
+    atomic<bool> coordinatorLost;
+    mutex connectionMutex;           // Guards inbound and readers
+    vector<SOCKET> inbound;
+    vector<thread> readers;
+
+    Cluster();
+
+    void acceptLoop(bool coordinator);
+    void readPeer(SOCKET sock);
+    void exchangeLoop();
+    void controlLoop();
+    bool sendBatch(int node, const string& records, size_t count);
+    void sendStatus();
+
+    // Coordinator state
+    struct Report {
+        bool idle = false;
+        uint64_t sent = 0;
+        uint64_t received = 0;
+        uint64_t sequence = 0;       // Reports received so far
+        SOCKET sock = INVALID_SOCKET;
+    };
+    mutex reportMutex;
+    vector<Report> reports;
+    void readWorker(SOCKET sock);
+};
+
+#endif
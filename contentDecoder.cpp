@@ -0,0 +1,169 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  ContentDecoder Implementation
+ * ----------------------------------------------------------------------------
+ *  Both decoders work on whatever piece of the body arrived and emit their
+ *  output through a fixed stack buffer, so decoding a page never needs the
+ *  whole compressed or decompressed body in memory.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "contentDecoder.h"
+#include <zlib.h>
+#include <cctype>
+
+#ifdef WEBREAPER_BROTLI
+#include <brotli/decode.h>
+#endif
+
+namespace {
+
+const size_t outputChunk = 16384;
+
+string normalizeCoding(const string& text) {
+    string result;
+    for (char ch : text) {
+        if (ch != ' ' && ch != '\t') result += (char)tolower((unsigned char)ch);
+    }
+    return result;
+}
+
+}
+
+ContentDecoder::ContentDecoder()
+    : codec(Codec::Identity), started(false), finished(false), zlib(nullptr), brotli(nullptr) {}
+
+ContentDecoder::~ContentDecoder() {
+    if (zlib) {
+        inflateEnd(zlib);
+        delete zlib;
+    }
+    releaseBrotli();
+}
+
+const char* ContentDecoder::acceptEncoding() {
+#ifdef WEBREAPER_BROTLI
+    return "gzip, deflate, br";
+#else
+    return "gzip, deflate";
+#endif
+}
+
+bool ContentDecoder::begin(const string& contentEncoding) {
+    string coding = normalizeCoding(contentEncoding);
+    started = false;
+    finished = false;
+    releaseBrotli();
+
+    if (coding.empty() || coding == "identity") codec = Codec::Identity;
+    else if (coding == "gzip" || coding == "x-gzip") codec = Codec::Gzip;
+    else if (coding == "deflate") codec = Codec::Deflate;
+#ifdef WEBREAPER_BROTLI
+    else if (coding == "br") codec = Codec::Brotli;
+#endif
+    else {
+        codec = Codec::Identity;
+        return false;   // Unknown or stacked codings
+    }
+    return true;
+}
+
+bool ContentDecoder::startZlib(int windowBits) {
+    if (!zlib) {
+        zlib = new z_stream();
+        if (inflateInit2(zlib, windowBits) != Z_OK) {
+            delete zlib;
+            zlib = nullptr;
+            return false;
+        }
+        return true;
+    }
+    return inflateReset2(zlib, windowBits) == Z_OK;
+}
+
+bool ContentDecoder::feed(const char* data, size_t length, const Sink& sink) {
+    if (length == 0 || finished) return true;   // Trailing bytes after the stream are ignored
+
+    if (!started) {
+        started = true;
+        if (codec == Codec::Gzip) {
+            if (!startZlib(16 + MAX_WBITS)) return false;
+        } else if (codec == Codec::Deflate) {
+            // "deflate" should be zlib-wrapped, but some servers send a raw
+            // stream; a zlib header has compression method 8 in the low nibble
+            unsigned char first = (unsigned char)data[0];
+            bool wrapped = (first & 0x0f) == 8 && (first >> 4) <= 7;
+            if (!startZlib(wrapped ? MAX_WBITS : -MAX_WBITS)) return false;
+        } else if (codec == Codec::Brotli) {
+#ifdef WEBREAPER_BROTLI
+            brotli = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+            if (!brotli) return false;
+#endif
+        }
+    }
+
+    if (codec == Codec::Brotli) return feedBrotli(data, length, sink);
+    if (codec == Codec::Gzip || codec == Codec::Deflate) return feedZlib(data, length, sink);
+
+    sink(data, length);
+    return true;
+}
+
+bool ContentDecoder::feedZlib(const char* data, size_t length, const Sink& sink) {
+    char output[outputChunk];
+    zlib->next_in = (Bytef*)data;
+    zlib->avail_in = (uInt)length;
+
+    while (zlib->avail_in > 0 || zlib->avail_out == 0) {
+        zlib->next_out = (Bytef*)output;
+        zlib->avail_out = sizeof(output);
+
+        int result = inflate(zlib, Z_NO_FLUSH);
+        size_t produced = sizeof(output) - zlib->avail_out;
+        if (produced > 0) sink(output, produced);
+
+        if (result == Z_STREAM_END) {
+            finished = true;
+            break;
+        }
+        if (result == Z_BUF_ERROR && zlib->avail_in == 0) break;   // Needs more input
+        if (result != Z_OK) return false;
+    }
+    return true;
+}
+
+bool ContentDecoder::feedBrotli(const char* data, size_t length, const Sink& sink) {
+#ifdef WEBREAPER_BROTLI
+    char output[outputChunk];
+    const uint8_t* input = (const uint8_t*)data;
+    size_t available = length;
+
+    while (true) {
+        uint8_t* next = (uint8_t*)output;
+        size_t space = sizeof(output);
+        BrotliDecoderResult result =
+            BrotliDecoderDecompressStream(brotli, &available, &input, &space, &next, nullptr);
+        size_t produced = sizeof(output) - space;
+        if (produced > 0) sink(output, produced);
+
+        if (result == BROTLI_DECODER_RESULT_SUCCESS) {
+            finished = true;
+            return true;
+        }
+        if (result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) return true;
+        if (result == BROTLI_DECODER_RESULT_ERROR) return false;
+    }
+#else
+    (void)data;
+    (void)length;
+    (void)sink;
+    return false;
+#endif
+}
+
+void ContentDecoder::releaseBrotli() {
+#ifdef WEBREAPER_BROTLI
+    if (brotli) BrotliDecoderDestroyInstance(brotli);
+#endif
+    brotli = nullptr;
+}
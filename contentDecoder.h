@@ -0,0 +1,70 @@
+/*
+* ----------------------------------------------------------------------------
+ *  ContentDecoder Header - Streaming Content-Encoding Decompression
+ * ----------------------------------------------------------------------------
+ *  This header defines the ContentDecoder class, which undoes the
+ *  Content-Encoding of a response body while it is being received. It is
+ *  driven by HttpResponse with the de-chunked body bytes and passes the
+ *  decoded bytes on to the body sink, so compressed pages are extracted
+ *  chunk by chunk just like plain ones.
+ *
+ *  Key Features:
+ *  - gzip and deflate through zlib (zlib-wrapped and raw deflate streams).
+ *  - br through the Brotli decoder when built with WEBREAPER_BROTLI.
+ *  - The zlib stream is reset rather than reallocated between responses.
+ *  - acceptEncoding() lists exactly the codings this build can decode.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef CONTENTDECODER_H
+#define CONTENTDECODER_H
+
+#include <string>
+#include <cstddef>
+#include <functional>
+
+using namespace std;
+
+struct z_stream_s;
+struct BrotliDecoderStateStruct;
+
+class ContentDecoder {
+public:
+    typedef function<void(const char* data, size_t length)> Sink;
+
+    ContentDecoder();
+    ~ContentDecoder();
+
+    // Value for the Accept-Encoding request header
+    static const char* acceptEncoding();
+
+    // Prepares for a body with the given Content-Encoding header value.
+    // Returns false when the coding is not supported.
+    bool begin(const string& contentEncoding);
+
+    // Decodes the next piece of the body into sink. Returns false when the
+    // data is corrupt; the rest of the body should then be discarded.
+    bool feed(const char* data, size_t length, const Sink& sink);
+
+    // True when the body is encoded (feed() must be used)
+    bool active() const { return codec != Codec::Identity; }
+
+    ContentDecoder(const ContentDecoder&) = delete;
+    ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+private:
+    enum class Codec { Identity, Gzip, Deflate, Brotli };
+
+    Codec codec;
+    bool started;                        // First byte of the body seen
+    bool finished;                       // End of the compressed stream reached
+    z_stream_s* zlib;                    // Created on first use, then reset per body
+    BrotliDecoderStateStruct* brotli;    // Created per body
+
+    bool startZlib(int windowBits);
+    bool feedZlib(const char* data, size_t length, const Sink& sink);
+    bool feedBrotli(const char* data, size_t length, const Sink& sink);
+    void releaseBrotli();
+};
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  CrawlJournal Implementation
+ * ----------------------------------------------------------------------------
+ *  Record layout (native byte order): one type byte, then
+ *    'S' site queued:    u16 length, hostname, i32 depth
+ *    'F' site finished:  u64 host fingerprint
+ *    'Q' page queued:    u64 host fingerprint, u16 length, path
+ *    'V' page visited:   u64 host fingerprint, u16 length, path, f32 ms
+ *    'L' linked site:    u64 host fingerprint, u16 length, linked hostname
+ *  Host fingerprints are urlFingerprint(), the same value the seen-site set
+ *  stores, so finished sites can be restored without their names.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "crawlJournal.h"
+#include "urlSet.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+void putBytes(string& out, const void* data, size_t length) {
+    out.append(static_cast<const char*>(data), length);
+}
+
+void putText(string& out, string_view text) {
+    uint16_t length = (uint16_t)min<size_t>(text.size(), 0xFFFF);
+    putBytes(out, &length, sizeof(length));
+    out.append(text.data(), length);
+}
+
+void putFingerprint(string& out, string_view hostname) {
+    uint64_t fingerprint = urlFingerprint(hostname);
+    putBytes(out, &fingerprint, sizeof(fingerprint));
+}
+
+// Reads records straight from the file, so replay never holds the whole
+// journal in memory; a short read is a torn record
+struct Reader {
+    istream& in;
+
+    bool get(void* out, size_t length) {
+        return (bool)in.read(static_cast<char*>(out), length);
+    }
+
+    bool getText(string& out) {
+        uint16_t length;
+        if (!get(&length, sizeof(length))) return false;
+        out.resize(length);
+        return length == 0 || get(&out[0], length);
+    }
+};
+
+// The journal is rewritten once it grows this much past its live state
+const long minCompactBytes = 16 << 20;
+const long compactGrowth = 4;
+
+}
+
+CrawlJournal& CrawlJournal::shared() {
+    static CrawlJournal journal;
+    return journal;
+}
+
+void CrawlJournal::start(const string& path, int intervalSeconds) {
+    open(path, false, intervalSeconds);
+}
+
+void CrawlJournal::resume(const string& path, int intervalSeconds, const Snapshot& snapshot) {
+    stop();
+    writeSnapshot(path, snapshot);
+    open(path, true, intervalSeconds);
+}
+
+// Compact snapshot, written beside the journal and renamed over it; returns
+// its size. Throws runtime_error when it cannot be written.
+long CrawlJournal::writeSnapshot(const string& path, const Snapshot& snapshot) {
+    string compact;
+    for (uint64_t fingerprint : snapshot.finishedSites) {
+        compact += 'F';
+        putBytes(compact, &fingerprint, sizeof(fingerprint));
+    }
+    for (const RestoredSite& site : snapshot.pendingSites) {
+        compact += 'S';
+        putText(compact, site.hostname);
+        int32_t depth = site.depth;
+        putBytes(compact, &depth, sizeof(depth));
+
+        for (const RestoredPage& page : site.pages) {
+            if (page.path != "/") {
+                compact += 'Q';
+                putFingerprint(compact, site.hostname);
+                putText(compact, page.path);
+            }
+            if (page.visited) {
+                compact += 'V';
+                putFingerprint(compact, site.hostname);
+                putText(compact, page.path);
+                float responseTime = (float)page.responseTime;
+                putBytes(compact, &responseTime, sizeof(responseTime));
+            }
+        }
+        for (const string& linked : site.linkedSites) {
+            compact += 'L';
+            putFingerprint(compact, site.hostname);
+            putText(compact, linked);
+        }
+    }
+
+    string temporary = path + ".tmp";
+    FILE* out = fopen(temporary.c_str(), "wb");
+    if (!out) throw runtime_error("Cannot create " + temporary);
+    bool ok = compact.empty() || fwrite(compact.data(), compact.size(), 1, out) == 1;
+    ok = fclose(out) == 0 && ok;
+    if (!ok) {
+        remove(temporary.c_str());
+        throw runtime_error("Cannot write " + temporary);
+    }
+    remove(path.c_str());
+    if (rename(temporary.c_str(), path.c_str()) != 0) throw runtime_error("Cannot write " + path);
+    return (long)compact.size();
+}
+
+void CrawlJournal::open(const string& journalPath, bool append, int intervalSeconds) {
+    stop();
+    path = journalPath;
+    file = fopen(path.c_str(), append ? "ab" : "wb");
+    if (!file) throw runtime_error("Cannot open checkpoint file " + path);
+    fseek(file, 0, SEEK_END);
+    fileBytes = compactedBytes = ftell(file);
+
+    stopping = false;
+    active = true;
+    flusher = thread(&CrawlJournal::flushLoop, this, intervalSeconds);
+}
+
+void CrawlJournal::stop() {
+    if (flusher.joinable()) {
+        {
+            lock_guard<mutex> lock(stopMutex);
+            stopping = true;
+        }
+        stopSignal.notify_all();
+        flusher.join();
+    }
+
+    active = false;
+    flush();
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void CrawlJournal::flushLoop(int intervalSeconds) {
+    unique_lock<mutex> lock(stopMutex);
+    while (!stopping) {
+        stopSignal.wait_for(lock, chrono::seconds(intervalSeconds));
+        lock.unlock();
+        flush();
+        if (fileBytes > max(minCompactBytes, compactGrowth * compactedBytes)) compact();
+        lock.lock();
+    }
+}
+
+// Swaps the buffer out under the lock and writes it without holding it
+void CrawlJournal::flush() {
+    lock_guard<mutex> writeLock(flushMutex);
+    string pending;
+    {
+        lock_guard<mutex> lock(bufferMutex);
+        pending.swap(buffer);
+    }
+    if (!file || pending.empty()) return;
+    fwrite(pending.data(), pending.size(), 1, file);
+    fflush(file);
+    fileBytes += (long)pending.size();
+}
+
+// Replays the journal and rewrites it as the snapshot of the live state,
+// so its size follows the sites still in flight instead of the crawl's
+// whole history. Workers keep appending to the buffer meanwhile; those
+// records come after the snapshot. On failure the journal is left as is.
+void CrawlJournal::compact() {
+    lock_guard<mutex> writeLock(flushMutex);
+    if (!file) return;
+    fclose(file);
+    file = nullptr;
+    try {
+        fileBytes = compactedBytes = writeSnapshot(path, load(path));
+    }
+    catch (const exception&) {
+        compactedBytes = fileBytes;      // Retried once the journal grew again
+    }
+    file = fopen(path.c_str(), "ab");
+}
+
+void CrawlJournal::append(const string& record) {
+    lock_guard<mutex> lock(bufferMutex);
+    buffer += record;
+}
+
+void CrawlJournal::siteQueued(string_view hostname, int depth) {
+    if (!enabled()) return;
+    string record(1, 'S');
+    putText(record, hostname);
+    int32_t storedDepth = depth;
+    putBytes(record, &storedDepth, sizeof(storedDepth));
+    append(record);
+}
+
+void CrawlJournal::siteFinished(string_view hostname) {
+    if (!enabled()) return;
+    string record(1, 'F');
+    putFingerprint(record, hostname);
+    append(record);
+}
+
+void CrawlJournal::pageQueued(string_view hostname, string_view path) {
+    if (!enabled()) return;
+    string record(1, 'Q');
+    putFingerprint(record, hostname);
+    putText(record, path);
+    append(record);
+}
+
+void CrawlJournal::pageVisited(string_view hostname, string_view path, double responseTime) {
+    if (!enabled()) return;
+    string record(1, 'V');
+    putFingerprint(record, hostname);
+    putText(record, path);
+    float storedTime = (float)responseTime;
+    putBytes(record, &storedTime, sizeof(storedTime));
+    append(record);
+}
+
+void CrawlJournal::linkedSite(string_view hostname, string_view linked) {
+    if (!enabled()) return;
+    string record(1, 'L');
+    putFingerprint(record, hostname);
+    putText(record, linked);
+    append(record);
+}
+
+CrawlJournal::Snapshot CrawlJournal::load(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) throw runtime_error("Cannot open checkpoint file " + path);
+
+    // Sites in queue order; index by fingerprint for the per-site records
+    vector<RestoredSite> sites;
+    vector<uint64_t> siteFingerprints;
+    unordered_map<uint64_t, size_t> siteIndex;
+    unordered_map<uint64_t, bool> finished;
+    unordered_map<uint64_t, unordered_map<string, size_t>> pageIndex;
+
+    Reader reader{in};
+    char type;
+    while (reader.get(&type, 1)) {
+        uint64_t fingerprint = 0;
+        string text;
+        bool complete = true;
+
+        if (type == 'S') {
+            int32_t depth;
+            complete = reader.getText(text) && reader.get(&depth, sizeof(depth));
+            if (complete) {
+                fingerprint = urlFingerprint(text);
+                if (siteIndex.count(fingerprint) == 0) {
+                    siteIndex[fingerprint] = sites.size();
+                    siteFingerprints.push_back(fingerprint);
+                    RestoredSite site;
+                    site.hostname = text;
+                    site.depth = depth;
+                    site.pages.push_back(RestoredPage{"/", false, 0});
+                    pageIndex[fingerprint]["/"] = 0;
+                    sites.push_back(site);
+                }
+            }
+        } else if (type == 'F') {
+            complete = reader.get(&fingerprint, sizeof(fingerprint));
+            if (complete) {
+                finished[fingerprint] = true;
+                // A finished site is only its fingerprint from here on
+                auto it = siteIndex.find(fingerprint);
+                if (it != siteIndex.end()) {
+                    sites[it->second] = RestoredSite();
+                    pageIndex.erase(fingerprint);
+                }
+            }
+        } else if (type == 'Q' || type == 'V' || type == 'L') {
+            float responseTime = 0;
+            complete = reader.get(&fingerprint, sizeof(fingerprint)) && reader.getText(text) &&
+                       (type != 'V' || reader.get(&responseTime, sizeof(responseTime)));
+            auto it = siteIndex.find(fingerprint);
+            if (complete && it != siteIndex.end() && finished.count(fingerprint) == 0) {
+                RestoredSite& site = sites[it->second];
+                if (type == 'L') {
+                    site.linkedSites.push_back(text);
+                } else {
+                    auto& pages = pageIndex[fingerprint];
+                    auto page = pages.find(text);
+                    if (page == pages.end()) {
+                        page = pages.emplace(text, site.pages.size()).first;
+                        site.pages.push_back(RestoredPage{text, false, 0});
+                    }
+                    if (type == 'V') {
+                        site.pages[page->second].visited = true;
+                        site.pages[page->second].responseTime = responseTime;
+                    }
+                }
+            }
+        } else {
+            break;                       // Unknown byte: the file is corrupt from here on
+        }
+
+        if (!complete) break;            // Torn final record
+    }
+
+    Snapshot snapshot;
+    for (const auto& entry : finished) snapshot.finishedSites.push_back(entry.first);
+    for (size_t i = 0; i < sites.size(); i++) {
+        if (finished.count(siteFingerprints[i]) == 0) snapshot.pendingSites.push_back(move(sites[i]));
+    }
+    return snapshot;
+}
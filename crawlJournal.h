@@ -0,0 +1,120 @@
+/*
+* ----------------------------------------------------------------------------
+ *  CrawlJournal Header - Incremental Checkpoints and Resume
+ * ----------------------------------------------------------------------------
+ *  This header defines the CrawlJournal class, a process-wide append-only
+ *  log of every change to the crawl state: sites queued and finished, and
+ *  per site the pages queued and visited and the linked sites found. Worker
+ *  threads only append a few bytes to an in-memory buffer; a background
+ *  thread writes the buffer out every checkpoint interval, so checkpoints
+ *  never stop the crawl and each one costs only what changed since the last.
+ *
+ *  Key Features:
+ *  - Compact binary records; hosts inside page records are 64-bit
+ *    fingerprints rather than strings.
+ *  - Periodic flush on a background thread, plus a final flush at exit.
+ *  - Replay rebuilds the seen-site fingerprints, the site frontier, and the
+ *    progress of sites that were in flight. A torn record at the end of the
+ *    file (crash while writing) is ignored.
+ *  - On resume, and whenever the log has grown to several times its live
+ *    state, the journal is rewritten as a compact snapshot: sites that are
+ *    done shrink to their fingerprint. Replay streams the file and drops a
+ *    site's pages once it finished, so resuming costs what is still in
+ *    flight rather than the crawl's whole history.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef CRAWLJOURNAL_H
+#define CRAWLJOURNAL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+using namespace std;
+
+class CrawlJournal {
+public:
+    // A page of a site that had not finished when the journal was written
+    struct RestoredPage {
+        string path;
+        bool visited;
+        double responseTime;
+    };
+
+    // Unfinished site, in the order sites were queued
+    struct RestoredSite {
+        string hostname;
+        int depth;
+        vector<RestoredPage> pages;       // Queue order; "/" is always first
+        vector<string> linkedSites;
+    };
+
+    // Everything needed to continue an interrupted crawl
+    struct Snapshot {
+        vector<uint64_t> finishedSites;   // Fingerprints of sites already reported
+        vector<RestoredSite> pendingSites;
+    };
+
+    // Returns the journal shared by all threads of the process
+    static CrawlJournal& shared();
+
+    // Starts journaling to path, truncating it, and flushing every
+    // intervalSeconds. Throws runtime_error when the file cannot be created.
+    void start(const string& path, int intervalSeconds);
+
+    // Reads the journal at path; throws runtime_error when it cannot be read
+    static Snapshot load(const string& path);
+
+    // Starts journaling on top of a loaded snapshot: the file is first
+    // rewritten to hold just the snapshot, then appended to as usual
+    void resume(const string& path, int intervalSeconds, const Snapshot& snapshot);
+
+    // Writes out buffered records and stops the background thread
+    void stop();
+
+    bool enabled() const { return active.load(memory_order_relaxed); }
+
+    // Record appenders; no-ops while the journal is not enabled
+    void siteQueued(string_view hostname, int depth);
+    void siteFinished(string_view hostname);
+    void pageQueued(string_view hostname, string_view path);
+    void pageVisited(string_view hostname, string_view path, double responseTime);
+    void linkedSite(string_view hostname, string_view linked);
+
+private:
+    CrawlJournal() : active(false), file(nullptr), fileBytes(0), compactedBytes(0), stopping(false) {}
+    ~CrawlJournal() { stop(); }
+    CrawlJournal(const CrawlJournal&) = delete;
+    CrawlJournal& operator=(const CrawlJournal&) = delete;
+
+    atomic<bool> active;
+    mutex bufferMutex;
+    string buffer;                   // Records not yet written
+    FILE* file;
+    string path;
+    long fileBytes;                  // Size of the journal file (flushMutex)
+    long compactedBytes;             // Its size after the last rewrite (flushMutex)
+
+    mutex flushMutex;                // Serializes writes to file
+    thread flusher;
+    mutex stopMutex;
+    condition_variable stopSignal;
+    bool stopping;
+
+    void open(const string& path, bool append, int intervalSeconds);
+    void append(const string& record);
+    void flush();
+    void flushLoop(int intervalSeconds);
+    void compact();
+    static long writeSnapshot(const string& path, const Snapshot& snapshot);
+};
+
+#endif
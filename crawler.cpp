@@ -11,22 +11,41 @@
  *  - Thread-safe operations using RAII and lock guards
  *  - Improved error handling and resource cleanup
  *  - Structured crawling process with clear state management
- *  - Comprehensive statistics tracking and reporting
+ *  - Comprehensive statistics tracking and reporting, including latency
+ *    percentiles of every crawl phase
  *  - Memory-efficient data structures and operations
  * ----------------------------------------------------------------------------
  */
 
 #include "clientSocket.h"
 #include "parser.h"
+#include "dnsCache.h"
+#include "ioEngine.h"
+#include "threadPool.h"
+#include "pageScheduler.h"
+#include "urlSet.h"
+#include "bloomFilter.h"
+#include "spillQueue.h"
+#include "crawlJournal.h"
+#include "responseCache.h"
+#include "tlsTransport.h"
+#include "metrics.h"
+#include "resultSink.h"
+#include "urlFilter.h"
+#include "robots.h"
+#include "pageFrontier.h"
+#include "cluster.h"
 #include <iostream>
 #include <fstream>
 #include <thread>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
-#include <windows.h>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
 #include <iomanip>
-#include <sstream>
 
 using namespace std;
 
@@ -36,6 +55,45 @@ struct Config {
     int depthLimit = 10;
     int pagesLimit = 10;
     int linkedSitesLimit = 10;
+    bool keepAlive = true;
+    int dnsTtl = 300;
+    int dnsNegativeTtl = 30;
+    string ioEngine = "blocking";
+    int ioThreads = 2;
+    int maxConnections = 256;
+    int hostConnections = 1;
+    double hostBurst = 1;
+    string seenFilter = "exact";       // exact, bloom (filter in front of the exact set) or bloomOnly
+    int expectedUrls = 1000000;        // Sites the seen filter is sized for
+    double falsePositiveRate = 0.001;  // Target false-positive rate of the seen filter
+    int frontierCapacity = 65536;      // Sites the lock-free frontier holds before spilling
+    int frontierMemory = 64;           // MB of overflow sites kept in memory before going to disk
+    int pageFrontierMemory = 1024;     // KB of pending pages per site kept in memory
+    string spillDirectory = "spill";   // Where frontier segment files are written
+    string checkpointFile = "crawl.journal";  // Crawl journal used by --resume
+    int checkpointInterval = 10;       // Seconds between journal flushes; 0 disables checkpoints
+    string responseCache = "none";     // Directory of the conditional GET cache, or none
+    bool https = true;                 // Crawl https:// sites over TLS (when built with TLS support)
+    bool tlsVerify = true;             // Check server certificates and hostnames
+    string tlsCaFile;                  // CA bundle for tlsVerify; the system store when empty
+    int pipelineDepth = 1;             // Requests pipelined per keep-alive connection; 1 disables pipelining
+    int maxPageSize = 2048;            // KB of (decoded) body per page before it is abandoned; 0 for no limit
+    int metricsInterval = 0;           // Seconds between metrics dumps to stderr; 0 disables them
+    string outputFormat = "text";      // Site reports as text, jsonl or binary
+    string outputFile;                 // Where site reports go; stdout when empty
+    bool robots = true;                // Fetch robots.txt first and skip the pages it disallows
+    string userAgent = "WebReaper/1.0";  // Sent with every request; robots.txt groups are matched on "WebReaper"
+    vector<string> frontierScore = FrontierScorer::defaultTerms();  // Weighted features ranking pages; empty for FIFO
+    int slowHostMs = 0;                // Hosts averaging slower responses get one page task; 0 disables
+    bool adaptiveHosts = false;        // AIMD per-host concurrency and rate, timeouts from response times
+    int minTimeout = 1000;             // ms, lower bound of adaptive timeouts
+    int maxTimeout = 10000;            // ms, connect/send/receive timeout (upper bound when adaptive)
+    vector<string> allowedDomains = UrlFilter::defaultDomains();  // Domain suffixes crawled; empty allows all
+    vector<string> blockedTypes = UrlFilter::defaultTypes();      // File extensions never fetched
+    vector<string> clusterNodes;       // host:port of every worker of a distributed crawl; empty crawls alone
+    string coordinator;                // host:port of the distributed crawl's coordinator
+    int clusterBatch = 256;            // Sites per batch forwarded to another worker
+    int clusterFlushMs = 50;           // ms a partial batch waits before it is sent anyway
     LinkedList startUrls;
 
     void validate() const {
@@ -44,63 +102,128 @@ struct Config {
         if (depthLimit < 0) throw runtime_error("Depth limit cannot be negative");
         if (pagesLimit < -1) throw runtime_error("Pages limit cannot be less than -1");
         if (linkedSitesLimit < 0) throw runtime_error("Linked sites limit cannot be negative");
+        if (dnsTtl < 0 || dnsNegativeTtl < 0) throw runtime_error("DNS cache TTLs cannot be negative");
+        if (ioEngine != "blocking" && ioEngine != "async") throw runtime_error("ioEngine must be blocking or async");
+        if (ioThreads <= 0) throw runtime_error("I/O threads must be positive");
+        if (maxConnections <= 0) throw runtime_error("Max connections must be positive");
+        if (hostConnections <= 0) throw runtime_error("Host connections must be positive");
+        if (hostBurst < 1) throw runtime_error("Host burst must be at least 1");
+        if (seenFilter != "exact" && seenFilter != "bloom" && seenFilter != "bloomOnly")
+            throw runtime_error("seenFilter must be exact, bloom or bloomOnly");
+        if (expectedUrls <= 0) throw runtime_error("Expected URLs must be positive");
+        if (falsePositiveRate <= 0 || falsePositiveRate >= 1)
+            throw runtime_error("False positive rate must be between 0 and 1");
+        if (frontierCapacity <= 0) throw runtime_error("Frontier capacity must be positive");
+        if (frontierMemory <= 0 || pageFrontierMemory <= 0) throw runtime_error("Frontier memory budgets must be positive");
+        if (checkpointInterval < 0) throw runtime_error("Checkpoint interval cannot be negative");
+        if (pipelineDepth <= 0) throw runtime_error("Pipeline depth must be positive");
+        if (maxPageSize < 0) throw runtime_error("Max page size cannot be negative");
+        if (metricsInterval < 0) throw runtime_error("Metrics interval cannot be negative");
+        ResultSink::parseFormat(outputFormat);
+        if (outputFormat == "binary" && outputFile.empty()) throw runtime_error("Binary output needs an outputFile");
+        FrontierScorer::parseTerms(frontierScore);
+        if (slowHostMs < 0) throw runtime_error("Slow host threshold cannot be negative");
+        if (minTimeout <= 0 || maxTimeout < minTimeout) throw runtime_error("Timeouts must be positive, minTimeout at most maxTimeout");
+        if (robots && userAgent.empty()) throw runtime_error("Honoring robots.txt needs a userAgent");
+        if (!clusterNodes.empty()) {
+            for (const string& node : clusterNodes) Cluster::parseNode(node);
+            Cluster::parseNode(coordinator);
+            if (clusterBatch <= 0) throw runtime_error("Cluster batch must be positive");
+            if (clusterFlushMs < 0) throw runtime_error("Cluster flush delay cannot be negative");
+        }
         if (startUrls.empty()) throw runtime_error("No start URLs provided");
     }
 };
 
+// Site waiting in the frontier
+struct FrontierEntry {
+    string hostname;
+    int depth = 0;
+};
+
 struct CrawlerState {
-    int threadsCount{0};
-    LinkedList pendingSites;
-    map<string, bool> discoveredSites;
+    atomic<int> threadsCount{0};      // Sites in flight (or being taken from the frontier)
+    unique_ptr<Queue<FrontierEntry>> frontier;   // Start sites, and the async engine's frontier
+    unique_ptr<SpillQueue> overflowSites;  // Sites pushed while the frontier was full (stateMutex)
+    atomic<size_t> overflowCount{0};  // Size of overflowSites, readable without the lock
+    atomic<int> waiters{0};           // Event loops blocked on stateChanged
+    unordered_map<string, CrawlJournal::RestoredSite> resumedSites;  // Progress of sites cut short
+    mutex resumeMutex;                // Guards resumedSites
+    UrlFingerprintSet discoveredSites;  // Fingerprints of every site ever queued (unused in bloomOnly)
+    unique_ptr<BloomFilter> seenFilter; // Lock-free filter in front of (or instead of) discoveredSites
+    mutex discoveredMutex;              // Guards discoveredSites
+    atomic<size_t> filterFalsePositives{0};  // Sites the filter alone would have dropped
+    atomic<size_t> bytesOnWire{0};      // Response bytes received over all sites
+    atomic<size_t> bytesDecoded{0};     // Page body bytes after decompression over all sites
+    atomic<size_t> pagesDisallowed{0};  // Pages skipped for robots.txt over all sites
     mutex stateMutex;
     condition_variable stateChanged;
     bool isFinished{false};
 };
 
-class ThreadGuard {
-    CrawlerState& state;
-    mutex& mtx;
-    condition_variable& cv;
+Config config;
+CrawlerState crawlerState;
 
-public:
-    ThreadGuard(CrawlerState& s, mutex& m, condition_variable& c)
-        : state(s), mtx(m), cv(c) {}
+// Acquires stateMutex, recording how long the caller waited for it
+unique_lock<mutex> lockState() {
+    auto waitStart = chrono::steady_clock::now();
+    unique_lock<mutex> lock(crawlerState.stateMutex);
+    Metrics::shared().record(Metric::StateLock, waitStart);
+    return lock;
+}
 
-    ~ThreadGuard() {
-        lock_guard<mutex> lock(mtx);
-        state.threadsCount--;
-        cv.notify_all();
+// Text beside the reports: it shares stdout with text reports only, so
+// JSON Lines and binary reports on stdout stay machine-readable
+ostream& statusStream() {
+    return config.outputFormat == "text" ? cout : cerr;
+}
+
+// Prints totals that span the whole crawl rather than a single site
+void printCrawlTotals(ostream& out) {
+    out << fixed << setprecision(3) << "Phase Latency (p50 / p90 / p99):\n";
+    Metrics::shared().print(out);
+
+    const DnsCache& dns = DnsCache::shared();
+    out << "DNS Cache Hits: " << dns.hits() << "\n"
+         << "DNS Cache Misses: " << dns.misses() << "\n"
+         << "DNS Negative Cache Hits: " << dns.negativeHits() << "\n"
+         << "Bytes On Wire: " << crawlerState.bytesOnWire.load() << "\n"
+         << "Bytes Decoded: " << crawlerState.bytesDecoded.load() << "\n";
+
+    const ResponseCache& cache = ResponseCache::shared();
+    if (cache.enabled()) {
+        out << "Response Cache Revalidated: " << cache.revalidated() << "\n"
+             << "Response Cache Stored: " << cache.stored() << "\n";
     }
-};
 
-Config config;
-CrawlerState crawlerState;
+    const RobotsCache& robots = RobotsCache::shared();
+    if (robots.enabled()) {
+        out << "Robots.txt Hosts: " << robots.hosts() << "\n"
+             << "Pages Disallowed by Robots.txt: " << crawlerState.pagesDisallowed.load() << "\n";
+    }
 
-// Updated printCrawlingSummary function to match desired output format
-void printCrawlingSummary(const SiteStats& stats, int depth) {
-    stringstream ss;
-    ss << fixed << setprecision(3);
+    const Cluster& cluster = Cluster::shared();
+    if (cluster.enabled()) {
+        out << "Cluster Sites Sent: " << cluster.sitesSent() << "\n"
+             << "Cluster Sites Received: " << cluster.sitesReceived() << "\n"
+             << "Cluster Bytes Sent: " << cluster.bytesSent() << " (" << cluster.rawBytesSent() << " before compression)\n";
+    }
 
-    // Basic site information
-    ss << "Website: " << stats.hostname << "\n"
-       << "Depth (distance from the starting pages): " << depth << "\n"
-       << "Number of Pages Discovered: " << stats.visitedPages.size() << "\n"
-       << "Number of Pages Failed to Discover: " << stats.numberOfPagesFailed << "\n"
-       << "Number of Linked Sites: " << (stats.linkedSites.getHead() ? 1 : 0) << "\n"
-       << "Min. Response Time: " << stats.minResponseTime << "ms\n"
-       << "Max. Response Time: " << stats.maxResponseTime << "ms\n"
-       << "Average Response Time: " << stats.averageResponseTime << "ms\n";
+    const TlsContext& tls = TlsContext::shared();
+    if (tls.enabled()) {
+        out << "TLS Full Handshakes: " << tls.fullHandshakes() << "\n"
+             << "TLS Resumed Handshakes: " << tls.resumedHandshakes() << "\n";
+    }
 
-    // List of visited pages
-    if (!stats.visitedPages.empty()) {
-        ss << "List of visited pages:\n";
-        ss << "Response Time\tURL\n";
-        for (const auto& page : stats.visitedPages) {
-            ss << page.responseTime << "ms\t" << page.url << "\n";
+    if (crawlerState.seenFilter) {
+        const BloomFilter& filter = *crawlerState.seenFilter;
+        out << "Seen Filter Sites: " << filter.size() << "\n"
+             << "Seen Filter Memory: " << filter.memoryBytes() / 1024 << "KB\n"
+             << "Seen Filter Estimated False Positive Rate: " << filter.estimatedFalsePositiveRate() << "\n";
+        if (config.seenFilter == "bloom") {
+            out << "Seen Filter False Positives: " << crawlerState.filterFalsePositives.load() << "\n";
         }
     }
-
-    cout << ss.str();
 }
 
 Config readConfigFile() {
@@ -118,6 +241,54 @@ Config readConfigFile() {
         else if (var == "depthLimit") cf.depthLimit = stoi(val);
         else if (var == "pagesLimit") cf.pagesLimit = stoi(val);
         else if (var == "linkedSitesLimit") cf.linkedSitesLimit = stoi(val);
+        else if (var == "keepAlive") cf.keepAlive = stoi(val) != 0;
+        else if (var == "dnsTtl") cf.dnsTtl = stoi(val);
+        else if (var == "dnsNegativeTtl") cf.dnsNegativeTtl = stoi(val);
+        else if (var == "ioEngine") cf.ioEngine = val;
+        else if (var == "ioThreads") cf.ioThreads = stoi(val);
+        else if (var == "maxConnections") cf.maxConnections = stoi(val);
+        else if (var == "hostConnections") cf.hostConnections = stoi(val);
+        else if (var == "hostBurst") cf.hostBurst = stod(val);
+        else if (var == "seenFilter") cf.seenFilter = val;
+        else if (var == "expectedUrls") cf.expectedUrls = stoi(val);
+        else if (var == "falsePositiveRate") cf.falsePositiveRate = stod(val);
+        else if (var == "frontierCapacity") cf.frontierCapacity = stoi(val);
+        else if (var == "frontierMemory") cf.frontierMemory = stoi(val);
+        else if (var == "pageFrontierMemory") cf.pageFrontierMemory = stoi(val);
+        else if (var == "spillDirectory") cf.spillDirectory = val;
+        else if (var == "checkpointFile") cf.checkpointFile = val;
+        else if (var == "checkpointInterval") cf.checkpointInterval = stoi(val);
+        else if (var == "responseCache") cf.responseCache = val;
+        else if (var == "maxPageSize") cf.maxPageSize = stoi(val);
+        else if (var == "pipelineDepth") cf.pipelineDepth = stoi(val);
+        else if (var == "https") cf.https = stoi(val) != 0;
+        else if (var == "tlsVerify") cf.tlsVerify = stoi(val) != 0;
+        else if (var == "tlsCaFile") cf.tlsCaFile = val;
+        else if (var == "metricsInterval") cf.metricsInterval = stoi(val);
+        else if (var == "outputFormat") cf.outputFormat = val;
+        else if (var == "outputFile") cf.outputFile = val;
+        else if (var == "robots") cf.robots = stoi(val) != 0;
+        else if (var == "userAgent") cf.userAgent = val;
+        else if (var == "slowHostMs") cf.slowHostMs = stoi(val);
+        else if (var == "adaptiveHosts") cf.adaptiveHosts = stoi(val) != 0;
+        else if (var == "minTimeout") cf.minTimeout = stoi(val);
+        else if (var == "maxTimeout") cf.maxTimeout = stoi(val);
+        else if (var == "coordinator") cf.coordinator = val;
+        else if (var == "clusterBatch") cf.clusterBatch = stoi(val);
+        else if (var == "clusterFlushMs") cf.clusterFlushMs = stoi(val);
+        else if (var == "allowedDomains" || var == "blockedTypes" || var == "frontierScore" || var == "clusterNodes") {
+            vector<string>& list = var == "allowedDomains" ? cf.allowedDomains
+                                 : var == "blockedTypes" ? cf.blockedTypes
+                                 : var == "frontierScore" ? cf.frontierScore : cf.clusterNodes;
+            int entryCount = stoi(val);
+            list.clear();
+            for (int i = 0; i < entryCount; i++) {
+                if (!(cfFile >> url)) {
+                    throw runtime_error("Insufficient entries for " + var + " in config file");
+                }
+                list.push_back(url);
+            }
+        }
         else if (var == "startUrls") {
             int urlCount = stoi(val);
             for (int i = 0; i < urlCount; i++) {
@@ -132,85 +303,384 @@ Config readConfigFile() {
     return cf;
 }
 
-void initialize() {
+// Records a site as seen; returns true the first time it is seen. In
+// bloomOnly mode no lock is taken, and a false positive drops the site.
+bool markFingerprintSeen(uint64_t fingerprint) {
+    bool maybeSeen = false;
+
+    if (crawlerState.seenFilter) {
+        bool fresh = crawlerState.seenFilter->insert(fingerprint);
+        if (config.seenFilter == "bloomOnly") return fresh;
+        maybeSeen = !fresh;
+    }
+
+    lock_guard<mutex> lock(crawlerState.discoveredMutex);
+    bool inserted = crawlerState.discoveredSites.insert(fingerprint);
+    if (inserted && maybeSeen) crawlerState.filterFalsePositives++;
+    return inserted;
+}
+
+bool markSiteSeen(string_view hostname) {
+    return markFingerprintSeen(urlFingerprint(hostname));
+}
+
+// Queues a site for crawling. Lock-free unless the frontier is full or an
+// event loop is asleep waiting for work.
+void pushSite(string hostname, int depth) {
+    auto insertStart = chrono::steady_clock::now();
+    FrontierEntry entry;
+    entry.hostname = move(hostname);
+    entry.depth = depth;
+
+    if (!crawlerState.frontier->push(move(entry))) {
+        auto lock = lockState();
+        crawlerState.overflowSites->push(entry.hostname, entry.depth);
+        crawlerState.overflowCount++;
+    }
+    Metrics::shared().record(Metric::FrontierInsert, insertStart);
+
+    // Pairs with the fence in waitForSites(): either the waiter sees the
+    // site, or we see the waiter and wake it
+    atomic_thread_fence(memory_order_seq_cst);
+    if (crawlerState.waiters.load() > 0) {
+        auto lock = lockState();
+        crawlerState.stateChanged.notify_all();
+    }
+}
+
+// Takes the oldest queued site; overflowed sites come after the frontier's
+bool popSite(FrontierEntry& entry) {
+    if (crawlerState.frontier->pop(entry)) return true;
+    if (crawlerState.overflowCount.load() == 0) return false;
+
+    auto lock = lockState();
+    if (!crawlerState.overflowSites->pop(entry.hostname, entry.depth)) return false;
+    crawlerState.overflowCount--;
+    return true;
+}
+
+bool frontierEmpty() {
+    return crawlerState.frontier->empty() && crawlerState.overflowCount.load() == 0;
+}
+
+// Marks a site taken from the frontier as done (or the take as failed);
+// wakes sleeping event loops when this was the last site in flight
+void finishSiteSlot() {
+    if (--crawlerState.threadsCount == 0 && crawlerState.waiters.load() > 0) {
+        auto lock = lockState();
+        crawlerState.stateChanged.notify_all();
+    }
+}
+
+// Blocks until the frontier has a site or no site is left in flight;
+// returns false in the latter case (end of the crawl). A worker of a
+// distributed crawl keeps waiting for forwarded sites until the coordinator
+// ends the crawl.
+bool waitForSites() {
+    unique_lock<mutex> lock = lockState();
+    crawlerState.waiters++;
+    atomic_thread_fence(memory_order_seq_cst);
+    while (frontierEmpty() && (crawlerState.threadsCount.load() > 0 || Cluster::shared().running())) {
+        crawlerState.stateChanged.wait(lock);
+    }
+    crawlerState.waiters--;
+    return !frontierEmpty();
+}
+
+// Rebuilds the seen sites and the frontier from the checkpoint journal;
+// sites that were in flight keep their page progress
+void resumeFromCheckpoint() {
+    CrawlJournal::Snapshot snapshot = CrawlJournal::load(config.checkpointFile);
+
+    for (uint64_t fingerprint : snapshot.finishedSites) markFingerprintSeen(fingerprint);
+    for (const auto& site : snapshot.pendingSites) {
+        markSiteSeen(site.hostname);
+        pushSite(site.hostname, site.depth);
+        if (site.pages.size() > 1 || site.pages[0].visited || !site.linkedSites.empty()) {
+            crawlerState.resumedSites[site.hostname] = site;
+        }
+    }
+
+    statusStream() << "Resumed: " << snapshot.finishedSites.size() << " sites done, "
+         << snapshot.pendingSites.size() << " pending (" << crawlerState.resumedSites.size()
+         << " partly crawled)\n";
+
+    if (config.checkpointInterval > 0) {
+        CrawlJournal::shared().resume(config.checkpointFile, config.checkpointInterval, snapshot);
+    }
+}
+
+void initialize(bool resume) {
+    SpillQueue::configure(config.spillDirectory, 4 * 1024 * 1024);
+    crawlerState.frontier.reset(new Queue<FrontierEntry>(config.frontierCapacity));
+    crawlerState.overflowSites.reset(new SpillQueue((size_t)config.frontierMemory * 1024 * 1024));
+    if (config.seenFilter != "exact") {
+        crawlerState.seenFilter.reset(new BloomFilter(config.expectedUrls, config.falsePositiveRate));
+    }
+
+    if (resume) {
+        resumeFromCheckpoint();
+        return;
+    }
+
+    if (config.checkpointInterval > 0) {
+        CrawlJournal::shared().start(config.checkpointFile, config.checkpointInterval);
+    }
+
     Node* urlNode = config.startUrls.getHead();
     while (urlNode) {
-        string hostname = getHostnameFromUrl(urlNode->url);
-        crawlerState.pendingSites.add(hostname, "0");
-        crawlerState.discoveredSites[hostname] = true;
+        string hostname(getHostnameFromUrl(urlNode->url));
+        if (urlNode->url.compare(0, 8, "https://") == 0) TlsContext::shared().markSecure(hostname);
+        // Every worker reads the same start URLs and seeds only its own
+        if (Cluster::shared().owns(hostname) && markSiteSeen(hostname)) {
+            CrawlJournal::shared().siteQueued(hostname, 0);
+            pushSite(hostname, 0);
+        }
         urlNode = urlNode->next;
     }
 }
 
-void startCrawler(string hostname, int currentDepth) {
-    ThreadGuard guard(crawlerState, crawlerState.stateMutex, crawlerState.stateChanged);
-
-    try {
-        ClientSocket clientSocket(hostname, 80, config.pagesLimit, config.crawlDelay);
-        SiteStats stats = clientSocket.startDiscovering();
-
-        lock_guard<mutex> lock(crawlerState.stateMutex);
-        printCrawlingSummary(stats, currentDepth);
+// Creates the crawl state of a site taken from the frontier, restoring its
+// progress when the site was cut short by an interrupted earlier run
+ClientSocket* createSite(const string& hostname) {
+    int port = TlsContext::shared().enabled() && TlsContext::shared().isSecure(hostname) ? 443 : 80;
+    unique_ptr<ClientSocket> site(new ClientSocket(hostname, port, config.pagesLimit, config.crawlDelay, config.keepAlive,
+                                                   config.hostConnections, config.hostBurst,
+                                                   (size_t)config.pageFrontierMemory * 1024, config.pipelineDepth));
+
+    lock_guard<mutex> lock(crawlerState.resumeMutex);
+    auto saved = crawlerState.resumedSites.find(hostname);
+    if (saved != crawlerState.resumedSites.end()) {
+        site->restore(saved->second);
+        crawlerState.resumedSites.erase(saved);
+    }
+    return site.release();
+}
 
-        if (currentDepth < config.depthLimit) {
-            size_t linkedCount = 0;
-            Node* site = stats.linkedSites.getHead();
+// Collects the not yet seen linked sites of a crawled site into newSites,
+// forwarding those owned by another worker, then hands its report over to
+// the output stage
+void handleSiteResult(SiteStats&& stats, int currentDepth, UrlList& newSites) {
+    crawlerState.bytesOnWire += stats.bytesOnWire;
+    crawlerState.bytesDecoded += stats.bytesDecoded;
+    crawlerState.pagesDisallowed += stats.pagesDisallowed;
+
+    if (currentDepth < config.depthLimit) {
+        size_t linkedCount = 0;
+
+        // Best first, so the limit keeps the most linked sites rather than
+        // the first ones found
+        vector<const UrlRecord*> ranked;
+        for (const UrlRecord& site : stats.linkedSites) ranked.push_back(&site);
+        const FrontierScorer& scorer = FrontierScorer::shared();
+        if (scorer.ordered() && ranked.size() > static_cast<size_t>(config.linkedSitesLimit)) {
+            vector<pair<double, const UrlRecord*>> scored;
+            for (size_t i = 0; i < ranked.size(); i++) {
+                int inlinks = i < stats.linkedSiteInlinks.size() ? stats.linkedSiteInlinks[i] : 1;
+                scored.emplace_back(scorer.site(stats.linkedSites.host(*ranked[i]), inlinks), ranked[i]);
+            }
+            stable_sort(scored.begin(), scored.end(), [](const pair<double, const UrlRecord*>& a,
+                                                         const pair<double, const UrlRecord*>& b) {
+                return a.first > b.first;
+            });
+            for (size_t i = 0; i < scored.size(); i++) ranked[i] = scored[i].second;
+        }
 
-            while (site && linkedCount < static_cast<size_t>(config.linkedSitesLimit)) {
-                if (!crawlerState.discoveredSites[site->url]) {
-                    crawlerState.pendingSites.add(site->url, to_string(currentDepth + 1));
-                    crawlerState.discoveredSites[site->url] = true;
-                    linkedCount++;
+        for (const UrlRecord* site : ranked) {
+            if (linkedCount >= static_cast<size_t>(config.linkedSitesLimit)) break;
+            string_view hostname = stats.linkedSites.host(*site);
+            if (markSiteSeen(hostname)) {
+                Cluster& cluster = Cluster::shared();
+                if (cluster.owns(hostname)) {
+                    CrawlJournal::shared().siteQueued(hostname, currentDepth + 1);
+                    newSites.add(hostname, "", currentDepth + 1);
+                } else {
+                    cluster.forward(hostname, currentDepth + 1, TlsContext::shared().isSecure(hostname));
                 }
-                site = site->next;
+                linkedCount++;
             }
         }
+    }
 
-        crawlerState.stateChanged.notify_all();
+    // Logged after the linked sites, so a crash in between re-crawls this
+    // site rather than losing its linked sites
+    CrawlJournal::shared().siteFinished(stats.hostname);
+    ResultSink::shared().submit(move(stats), currentDepth);
+}
+
+void startCrawler(PageScheduler& scheduler, string hostname, int currentDepth);
+
+// Reports a finished site and starts crawling its new linked sites
+void finishCrawl(PageScheduler& scheduler, ThreadPool& pool, ClientSocket& site, int depth) {
+    UrlList newSites;
+    site.finishSite();
+    handleSiteResult(site.takeStats(), depth, newSites);
+
+    // Linked sites land on this worker's own deque; idle workers steal them
+    for (const UrlRecord& linked : newSites) {
+        string nextSite(newSites.host(linked));
+        int nextDepth = linked.depth;
+        crawlerState.threadsCount++;
+        pool.submit([&scheduler, nextSite, nextDepth] { startCrawler(scheduler, nextSite, nextDepth); });
+    }
+    finishSiteSlot();
+}
+
+void startCrawler(PageScheduler& scheduler, string hostname, int currentDepth) {
+    try {
+        scheduler.start(unique_ptr<ClientSocket>(createSite(hostname)), currentDepth);
     }
     catch (const exception& e) {
-        lock_guard<mutex> lock(crawlerState.stateMutex);
-        cerr << "Error crawling " << hostname << ": " << e.what() << endl;
-        crawlerState.stateChanged.notify_all();
+        {
+            auto lock = lockState();
+            cerr << "Error crawling " << hostname << ": " << e.what() << endl;
+        }
+        finishSiteSlot();
     }
 }
 
+// Runs the crawl on a persistent pool of maxThreads work-stealing workers;
+// pages, not sites, are the unit of work (see pageScheduler.h). Sites are
+// counted in threadsCount from the moment they are taken until
+// finishCrawl() submitted their linked sites, so the frontier only looks
+// drained once the crawl is.
 void scheduleCrawlers() {
-    vector<thread> activeThreads;
-
-    while (true) {
-        unique_lock<mutex> lock(crawlerState.stateMutex);
+    ThreadPool pool(config.maxThreads);
+    PageScheduler scheduler(pool, config.slowHostMs, [&scheduler, &pool](ClientSocket& site, int depth) {
+        finishCrawl(scheduler, pool, site, depth);
+    });
 
-        if (crawlerState.pendingSites.empty() && crawlerState.threadsCount == 0) {
-            break;
+    do {
+        while (true) {
+            crawlerState.threadsCount++;
+            FrontierEntry entry;
+            if (!popSite(entry)) {
+                finishSiteSlot();
+                break;
+            }
+            string nextSite = move(entry.hostname);
+            int depth = entry.depth;
+            pool.submit([&scheduler, nextSite, depth] { startCrawler(scheduler, nextSite, depth); });
         }
+    } while (waitForSites());
+
+    pool.waitIdle();
+}
 
-        while (!crawlerState.pendingSites.empty() &&
-               crawlerState.threadsCount < config.maxThreads) {
-            string nextSite = crawlerState.pendingSites.front();
-            int depth = stoi(crawlerState.pendingSites.getHead()->metadata);
-            crawlerState.pendingSites.pop();
+// Joins the distributed crawl once the frontier exists: forwarded sites go
+// through the same seen set and journal as local ones
+void startClusterWorker() {
+    Cluster::SiteHandler onSite = [](const string& hostname, int depth, bool secure) {
+        if (secure) TlsContext::shared().markSecure(hostname);
+        if (markSiteSeen(hostname)) {
+            CrawlJournal::shared().siteQueued(hostname, depth);
+            pushSite(hostname, depth);
+        }
+    };
+    Cluster::IdleCheck idle = [] {
+        return frontierEmpty() && crawlerState.threadsCount.load() == 0;
+    };
+    Cluster::StopHandler onStop = [] {
+        auto lock = lockState();
+        crawlerState.stateChanged.notify_all();
+    };
+    Cluster::shared().startWorker(Cluster::parseNode(config.coordinator), onSite, idle, onStop);
+}
 
+// Event-driven alternative: a few event loops multiplex every site in flight.
+// threadsCount counts the sites currently in flight. Loops take sites from
+// the lock-free frontier; stateMutex is only touched to sleep when idle.
+void scheduleAsyncCrawlers() {
+    AsyncEngine::SiteSource source = [](int& depth, bool wait) -> ClientSocket* {
+        while (true) {
+            // Count the site as in flight before taking it, so no other loop
+            // can see an empty frontier and nothing in flight in between
             crawlerState.threadsCount++;
-            thread t(startCrawler, nextSite, depth);
-            t.detach();
+            FrontierEntry entry;
+            if (popSite(entry)) {
+                try {
+                    depth = entry.depth;
+                    return createSite(entry.hostname);
+                }
+                catch (const exception& e) {
+                    auto lock = lockState();
+                    cerr << "Error crawling " << entry.hostname << ": " << e.what() << endl;
+                }
+                finishSiteSlot();
+                continue;
+            }
+            finishSiteSlot();
+
+            if (!wait || !waitForSites()) return nullptr;
         }
+    };
 
-        crawlerState.stateChanged.wait(lock, []{
-            return crawlerState.pendingSites.empty() ||
-                   crawlerState.threadsCount < config.maxThreads;
-        });
-    }
+    AsyncEngine::SiteSink sink = [](ClientSocket& site, int depth) {
+        UrlList newSites;
+        handleSiteResult(site.takeStats(), depth, newSites);
+        for (const UrlRecord& linked : newSites) {
+            pushSite(string(newSites.host(linked)), linked.depth);
+        }
+        finishSiteSlot();
+    };
+
+    AsyncEngine engine(config.ioThreads, config.maxConnections, source, sink);
+    engine.run();
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
+#ifdef _WIN32
         SetConsoleOutputCP(CP_UTF8);
+#endif
+        initNetwork();
+
+        bool resume = false;
+        bool coordinate = false;
+        int node = -1;
+        for (int i = 1; i < argc; i++) {
+            if (string(argv[i]) == "--resume") resume = true;
+            else if (string(argv[i]) == "--coordinator") coordinate = true;
+            else if (string(argv[i]) == "--node" && i + 1 < argc) node = stoi(argv[++i]);
+            else throw runtime_error(string("Unknown option ") + argv[i]);
+        }
 
         config = readConfigFile();
         config.validate();
-        initialize();
-        scheduleCrawlers();
+        if ((coordinate || node >= 0) && config.clusterNodes.empty()) {
+            throw runtime_error("--coordinator and --node need clusterNodes in config.txt");
+        }
+        if (coordinate) {
+            Cluster::shared().runCoordinator(Cluster::parseNode(config.coordinator), (int)config.clusterNodes.size());
+            return 0;
+        }
+        if (!config.clusterNodes.empty()) {
+            if (node < 0 || node >= (int)config.clusterNodes.size()) {
+                throw runtime_error("A worker needs --node with its index in clusterNodes");
+            }
+            vector<Cluster::Node> nodes;
+            for (const string& address : config.clusterNodes) nodes.push_back(Cluster::parseNode(address));
+            Cluster::shared().configure(nodes, node, config.clusterBatch, config.clusterFlushMs);
+        }
+        DnsCache::shared().configure(config.dnsTtl, config.dnsNegativeTtl);
+        UrlFilter::shared().configure(config.allowedDomains, config.blockedTypes);
+        FrontierScorer::shared().configure(config.frontierScore);
+        HostBudget::configure(config.adaptiveHosts, config.minTimeout, config.maxTimeout);
+        HostConnection::configure((size_t)config.maxPageSize * 1024, config.userAgent);
+        if (config.robots) RobotsCache::shared().configure(config.userAgent);
+        if (config.https) TlsContext::shared().configure(config.tlsVerify, config.tlsCaFile);
+        if (config.responseCache != "none") ResponseCache::shared().configure(config.responseCache);
+        ResultSink::shared().start(ResultSink::parseFormat(config.outputFormat), config.outputFile);
+        if (config.metricsInterval > 0) Metrics::shared().startDump(config.metricsInterval);
+        initialize(resume);
+        if (Cluster::shared().enabled()) startClusterWorker();
+        if (config.ioEngine == "async") scheduleAsyncCrawlers();
+        else scheduleCrawlers();
+        Cluster::shared().stop();
+        CrawlJournal::shared().stop();
+        Metrics::shared().stop();
+        ResultSink::shared().stop();
+        printCrawlTotals(statusStream());
 
         return 0;
     }
@@ -0,0 +1,157 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  DnsCache Implementation
+ * ----------------------------------------------------------------------------
+ *  Lookups are performed outside the cache lock so that a slow resolver
+ *  round-trip for one host never blocks threads resolving other hosts.
+ *  A lookup in progress is registered by hostname, so later callers wait
+ *  for it (or poll it) rather than asking the resolver again.
+ *  getaddrinfo() does not expose record TTLs, so every entry uses the
+ *  configured TTL.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "dnsCache.h"
+#include <cstring>
+
+namespace {
+
+const int resolverThreads = 4;   // Lookups resolveAsync() runs at once
+
+}
+
+DnsCache& DnsCache::shared() {
+    static DnsCache cache;
+    return cache;
+}
+
+void DnsCache::configure(int ttlSeconds, int negativeTtlSeconds) {
+    lock_guard<mutex> lock(cacheMutex);
+    ttl = chrono::seconds(ttlSeconds);
+    negativeTtl = chrono::seconds(negativeTtlSeconds);
+}
+
+void DnsCache::clear() {
+    lock_guard<mutex> lock(cacheMutex);
+    entries.clear();
+}
+
+void DnsCache::pin(const string& hostname, const SOCKADDR_IN& address) {
+    lock_guard<mutex> lock(cacheMutex);
+    pinned[hostname] = address;
+}
+
+// Answers from the pinned hosts or a live entry; cacheMutex must be held.
+// Returns false when the lookup has to go to the resolver.
+bool DnsCache::lookupCached(const string& hostname, SOCKADDR_IN& address, bool& found) {
+    auto fixed = pinned.find(hostname);
+    if (fixed != pinned.end()) {
+        hitCount++;
+        address = fixed->second;
+        found = true;
+        return true;
+    }
+    auto it = entries.find(hostname);
+    if (it == entries.end() || it->second.expires <= chrono::steady_clock::now()) return false;
+
+    found = it->second.found;
+    if (found) {
+        hitCount++;
+        address = it->second.address;
+    } else {
+        negativeHitCount++;
+    }
+    return true;
+}
+
+// Joins the lookup already running for hostname or registers a new one;
+// cacheMutex must be held. Returns true when the caller has to run it.
+bool DnsCache::startLookup(const string& hostname, shared_ptr<Lookup>& lookup) {
+    auto it = lookups.find(hostname);
+    if (it != lookups.end()) {
+        lookup = it->second;
+        return false;
+    }
+    missCount++;
+    lookup = make_shared<Lookup>();
+    lookups[hostname] = lookup;
+    return true;
+}
+
+// The resolver call itself, outside the lock; the result goes to the
+// cache and to everyone waiting on lookup
+void DnsCache::runLookup(const string& hostname, const shared_ptr<Lookup>& lookup) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    struct addrinfo* result = nullptr;
+    int status = getaddrinfo(hostname.c_str(), nullptr, &hints, &result);
+
+    Entry entry;
+    entry.found = (status == 0 && result != nullptr);
+    memset(&entry.address, 0, sizeof(entry.address));
+    if (entry.found) {
+        memcpy(&entry.address, result->ai_addr, sizeof(entry.address));
+    }
+    if (result) freeaddrinfo(result);
+
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        // Only a definite "no such host" is cached negatively; transient
+        // resolver failures are retried on the next lookup.
+        if (entry.found || status == EAI_NONAME) {
+            entry.expires = chrono::steady_clock::now() + (entry.found ? ttl : negativeTtl);
+            entries[hostname] = entry;
+        }
+        lookup->found = entry.found;
+        lookup->address = entry.address;
+        lookup->done = true;
+        lookups.erase(hostname);
+    }
+    lookupDone.notify_all();
+}
+
+bool DnsCache::resolve(const string& hostname, SOCKADDR_IN& address) {
+    shared_ptr<Lookup> lookup;
+    {
+        unique_lock<mutex> lock(cacheMutex);
+        bool found;
+        if (lookupCached(hostname, address, found)) return found;
+        if (!startLookup(hostname, lookup)) {
+            lookupDone.wait(lock, [&lookup] { return lookup->done; });
+            if (lookup->found) address = lookup->address;
+            return lookup->found;
+        }
+    }
+
+    runLookup(hostname, lookup);
+    if (lookup->found) address = lookup->address;
+    return lookup->found;
+}
+
+DnsCache::Answer DnsCache::resolveAsync(const string& hostname, SOCKADDR_IN& address, shared_ptr<Lookup>& lookup) {
+    ThreadPool* pool;
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        if (lookup) {
+            if (!lookup->done) return Answer::Pending;
+            bool found = lookup->found;
+            if (found) address = lookup->address;
+            lookup.reset();
+            return found ? Answer::Found : Answer::NotFound;
+        }
+
+        bool found;
+        if (lookupCached(hostname, address, found)) return found ? Answer::Found : Answer::NotFound;
+        if (!startLookup(hostname, lookup)) return Answer::Pending;
+        if (!resolvers) resolvers.reset(new ThreadPool(resolverThreads));
+        pool = resolvers.get();
+    }
+
+    shared_ptr<Lookup> started = lookup;
+    pool->submit([this, hostname, started] { runLookup(hostname, started); });
+    return Answer::Pending;
+}
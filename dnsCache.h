@@ -0,0 +1,102 @@
+/*
+* ----------------------------------------------------------------------------
+ *  DnsCache Header - Shared Hostname Resolution Cache
+ * ----------------------------------------------------------------------------
+ *  This header defines the DnsCache class, a process-wide, thread-safe cache
+ *  of hostname lookups shared by every crawler thread. It replaces the
+ *  blocking and non-reentrant gethostbyname() call that used to run for
+ *  every single page fetch.
+ *
+ *  Key Features:
+ *  - getaddrinfo()-based resolution (thread-safe).
+ *  - Entries expire after a configurable TTL.
+ *  - Negative caching of hosts that do not exist (NXDOMAIN).
+ *  - Hit/miss counters for the crawl summary.
+ *  - Pinned hosts, like hosts file entries, for local test servers.
+ *  - Concurrent misses for one hostname share a single lookup.
+ *  - A non-blocking variant for event loops: misses are resolved on a
+ *    few resolver threads and polled for.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DNSCACHE_H
+#define DNSCACHE_H
+
+#include "netPlatform.h"
+#include "threadPool.h"
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+class DnsCache {
+public:
+    enum class Answer { Found, NotFound, Pending };
+
+    // A resolver call in progress, shared by every caller waiting for it
+    struct Lookup {
+        bool done = false;
+        bool found = false;
+        SOCKADDR_IN address;
+    };
+
+    // Returns the cache shared by all threads of the process
+    static DnsCache& shared();
+
+    // Sets how long positive and negative lookups stay cached (in seconds)
+    void configure(int ttlSeconds, int negativeTtlSeconds);
+
+    // Resolves hostname to an IPv4 address; the port is left for the caller.
+    // Returns false when the host does not exist or lookup failed.
+    bool resolve(const string& hostname, SOCKADDR_IN& address);
+
+    // Never blocks: answers from the cache, or starts resolving hostname on
+    // the resolver threads and returns Pending with lookup set. Calling it
+    // again with that lookup returns Pending until the answer is in.
+    Answer resolveAsync(const string& hostname, SOCKADDR_IN& address, shared_ptr<Lookup>& lookup);
+
+    // Drops every cached entry
+    void clear();
+
+    // Resolves hostname to address from now on, without lookups; pinned
+    // hosts never expire and are kept by clear()
+    void pin(const string& hostname, const SOCKADDR_IN& address);
+
+    size_t hits() const { return hitCount.load(); }
+    size_t misses() const { return missCount.load(); }       // Resolver calls made
+    size_t negativeHits() const { return negativeHitCount.load(); }
+
+private:
+    struct Entry {
+        bool found;                                   // False for a cached NXDOMAIN
+        SOCKADDR_IN address;                          // Resolved address when found
+        chrono::steady_clock::time_point expires;     // When the entry must be refreshed
+    };
+
+    DnsCache() : ttl(300), negativeTtl(30), hitCount(0), missCount(0), negativeHitCount(0) {}
+    DnsCache(const DnsCache&) = delete;
+    DnsCache& operator=(const DnsCache&) = delete;
+
+    mutex cacheMutex;
+    condition_variable lookupDone;   // A lookup in lookups finished
+    unordered_map<string, Entry> entries;
+    unordered_map<string, SOCKADDR_IN> pinned;
+    unordered_map<string, shared_ptr<Lookup>> lookups;   // Resolver calls in progress
+    chrono::seconds ttl;
+    chrono::seconds negativeTtl;
+    atomic<size_t> hitCount;
+    atomic<size_t> missCount;
+    atomic<size_t> negativeHitCount;
+    unique_ptr<ThreadPool> resolvers;   // Created on the first resolveAsync() miss; last, so it stops first
+
+    bool lookupCached(const string& hostname, SOCKADDR_IN& address, bool& found);
+    bool startLookup(const string& hostname, shared_ptr<Lookup>& lookup);
+    void runLookup(const string& hostname, const shared_ptr<Lookup>& lookup);
+};
+
+#endif
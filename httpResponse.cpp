@@ -0,0 +1,223 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  HttpResponse Implementation
+ * ----------------------------------------------------------------------------
+ *  Incremental HTTP/1.1 response parser. The parser is a small state machine
+ *  driven by feed(); it never needs the whole response in one buffer, so the
+ *  caller can pass every recv() chunk straight through.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "httpResponse.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+string toLower(string text) {
+    for (char& ch : text) ch = (char)tolower((unsigned char)ch);
+    return text;
+}
+
+string trim(const string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == string::npos) return "";
+    size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+}
+
+void HttpResponse::reset() {
+    state = State::StatusLine;
+    framing = Framing::None;
+    status = 0;
+    versionMinor = 1;
+    remaining = 0;
+    bytesReceived = 0;
+    decodedBytes = 0;
+    line.clear();
+    bodyData.clear();
+    headers.clear();
+}
+
+void HttpResponse::appendBody(const char* data, size_t length) {
+    if (length == 0) return;
+    if (!decoder.active()) {
+        deliverBody(data, length);
+    } else if (!decoder.feed(data, length, [this](const char* plain, size_t size) { deliverBody(plain, size); })) {
+        state = State::Error;   // Corrupt compressed body
+    }
+}
+
+void HttpResponse::deliverBody(const char* data, size_t length) {
+    decodedBytes += length;
+    if (bodySink) bodySink(data, length);
+    else bodyData.append(data, length);
+}
+
+string HttpResponse::header(const string& name) const {
+    auto it = headers.find(toLower(name));
+    return it == headers.end() ? "" : it->second;
+}
+
+bool HttpResponse::keepAlive() const {
+    if (framing == Framing::UntilClose || state == State::Error || state == State::Aborted) return false;
+    string connection = toLower(header("Connection"));
+    if (connection.find("close") != string::npos) return false;
+    if (versionMinor == 0) return connection.find("keep-alive") != string::npos;
+    return true;
+}
+
+void HttpResponse::finishOnClose() {
+    if (state == State::Done || state == State::Aborted) return;
+    state = (state == State::Body && framing == Framing::UntilClose) ? State::Done : State::Error;
+}
+
+// Accumulates bytes into `line` until CRLF; returns true when a full line is available
+bool HttpResponse::readLine(const char* data, size_t length, size_t& pos) {
+    while (pos < length) {
+        char ch = data[pos++];
+        if (ch == '\n') {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        line += ch;
+        if (line.size() > 16384) {   // Guard against unbounded header lines
+            state = State::Error;
+            return false;
+        }
+    }
+    return false;
+}
+
+bool HttpResponse::parseStatusLine(const string& text) {
+    // Expected form: HTTP/1.x <code> <reason>
+    if (text.compare(0, 7, "HTTP/1.") != 0 || text.size() < 12) return false;
+    versionMinor = text[7] - '0';
+    status = atoi(text.c_str() + 9);
+    return status >= 100 && status <= 999;
+}
+
+bool HttpResponse::parseHeaderLine(const string& text) {
+    size_t colon = text.find(':');
+    if (colon == string::npos) return false;
+    string name = toLower(trim(text.substr(0, colon)));
+    string value = trim(text.substr(colon + 1));
+    auto it = headers.find(name);
+    if (it == headers.end()) headers[name] = value;
+    else it->second += ", " + value;
+    return true;
+}
+
+bool HttpResponse::beginBody() {
+    // Interim responses carry no body; parse the final response that follows
+    if (status >= 100 && status < 200) {
+        int minor = versionMinor;
+        reset();
+        versionMinor = minor;
+        return true;
+    }
+
+    if (headerCheck && !headerCheck(*this)) {
+        state = State::Aborted;
+        return false;
+    }
+
+    if (status == 204 || status == 304) {
+        state = State::Done;
+        return true;
+    }
+
+    if (!decoder.begin(header("Content-Encoding"))) {
+        state = State::Error;   // Coding we did not offer in Accept-Encoding
+        return false;
+    }
+
+    string transferEncoding = toLower(header("Transfer-Encoding"));
+    string contentLength = header("Content-Length");
+
+    if (transferEncoding.find("chunked") != string::npos) {
+        framing = Framing::Chunked;
+        state = State::ChunkSize;
+    } else if (!contentLength.empty()) {
+        framing = Framing::Length;
+        remaining = strtoul(contentLength.c_str(), nullptr, 10);
+        state = remaining == 0 ? State::Done : State::Body;
+    } else {
+        framing = Framing::UntilClose;
+        state = State::Body;
+    }
+    return true;
+}
+
+size_t HttpResponse::feed(const char* data, size_t length) {
+    size_t pos = 0;
+
+    while (pos < length && state != State::Done && state != State::Aborted && state != State::Error) {
+        switch (state) {
+        case State::StatusLine:
+            if (!readLine(data, length, pos)) break;
+            if (!parseStatusLine(line)) state = State::Error;
+            else state = State::Headers;
+            line.clear();
+            break;
+
+        case State::Headers:
+            if (!readLine(data, length, pos)) break;
+            if (line.empty()) beginBody();
+            else if (!parseHeaderLine(line)) state = State::Error;
+            line.clear();
+            break;
+
+        case State::Body:
+            if (framing == Framing::UntilClose) {
+                appendBody(data + pos, length - pos);
+                pos = length;
+            } else {
+                size_t take = min(remaining, length - pos);
+                appendBody(data + pos, take);
+                pos += take;
+                remaining -= take;
+                if (remaining == 0 && state == State::Body) state = State::Done;
+            }
+            break;
+
+        case State::ChunkSize:
+            if (!readLine(data, length, pos)) break;
+            remaining = strtoul(line.c_str(), nullptr, 16);   // Chunk extensions after ';' are ignored
+            if (line.empty() || !isxdigit((unsigned char)line[0])) state = State::Error;
+            else state = remaining == 0 ? State::Trailers : State::ChunkData;
+            line.clear();
+            break;
+
+        case State::ChunkData: {
+            size_t take = min(remaining, length - pos);
+            appendBody(data + pos, take);
+            pos += take;
+            remaining -= take;
+            if (remaining == 0 && state == State::ChunkData) state = State::ChunkDataEnd;
+            break;
+        }
+
+        case State::ChunkDataEnd:
+            if (!readLine(data, length, pos)) break;
+            state = line.empty() ? State::ChunkSize : State::Error;
+            line.clear();
+            break;
+
+        case State::Trailers:
+            if (!readLine(data, length, pos)) break;
+            if (line.empty()) state = State::Done;
+            line.clear();
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    bytesReceived += pos;
+    return pos;
+}
@@ -0,0 +1,111 @@
+/*
+* ----------------------------------------------------------------------------
+ *  HttpResponse Header - Incremental HTTP/1.1 Response Framing
+ * ----------------------------------------------------------------------------
+ *  This header defines the HttpResponse class, an incremental parser that is
+ *  fed raw bytes as they arrive from a socket and determines where a single
+ *  HTTP/1.1 response ends. This is what allows a keep-alive connection to be
+ *  reused for the next request instead of waiting for the server to close.
+ *
+ *  Key Features:
+ *  - Parses the status line and response headers.
+ *  - Frames the body using Content-Length, chunked transfer-encoding, or
+ *    connection close (in that order of preference).
+ *  - Reports whether the server allows the connection to be reused.
+ *  - Leaves any bytes past the end of the response unconsumed so they can
+ *    be handed to the next response on the same connection.
+ *  - Optionally streams the (de-chunked) body to a sink instead of
+ *    buffering it, so pages can be processed as they arrive.
+ *  - Lets the caller inspect status and headers before any body byte is
+ *    read, and abort responses it does not want.
+ *  - Decodes gzip/deflate/br Content-Encoding on the fly (see
+ *    contentDecoder.h) and counts wire and decoded bytes.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef HTTPRESPONSE_H
+#define HTTPRESPONSE_H
+
+#include <string>
+#include <map>
+#include <cstddef>
+#include <functional>
+#include "contentDecoder.h"
+
+using namespace std;
+
+class HttpResponse {
+public:
+    typedef function<void(const char* data, size_t length)> BodySink;
+    typedef function<bool(const HttpResponse& response)> HeaderCheck;
+
+    HttpResponse() { reset(); }
+
+    // Routes body bytes to sink instead of body(); it survives reset()
+    void setBodySink(BodySink sink) { bodySink = sink; }
+
+    // Called once the final response's headers are in; returning false
+    // aborts the response before its body is read. It survives reset().
+    void setHeaderCheck(HeaderCheck check) { headerCheck = check; }
+
+    // Stops parsing; the rest of the response is left unread, so the
+    // connection cannot be reused
+    void abort() { state = State::Aborted; }
+
+    // Feeds received bytes into the parser and returns how many of them
+    // belong to this response. Bytes past the end of the response are left
+    // for the caller to pass on to the next response.
+    size_t feed(const char* data, size_t length);
+
+    // Signals that the peer closed the connection. Completes a response whose
+    // body is delimited by connection close; otherwise marks it as truncated.
+    void finishOnClose();
+
+    // Clears all state so the object can parse the next response
+    void reset();
+
+    bool complete() const { return state == State::Done; }
+    bool failed() const { return state == State::Error; }
+    bool aborted() const { return state == State::Aborted; }
+    bool headersComplete() const { return state >= State::Body && state != State::Error; }
+    bool receivedAnything() const { return bytesReceived > 0; }
+
+    // True when the server permits another request on this connection
+    bool keepAlive() const;
+
+    int statusCode() const { return status; }
+    const string& body() const { return bodyData; }   // Empty when a body sink is set, decoded otherwise
+    size_t bytesOnWire() const { return bytesReceived; }   // Headers and encoded body
+    size_t bytesDecoded() const { return decodedBytes; }   // Body after chunking and Content-Encoding
+
+    // Returns the value of a response header (case-insensitive), or "" when absent
+    string header(const string& name) const;
+
+private:
+    enum class State { StatusLine, Headers, Body, ChunkSize, ChunkData, ChunkDataEnd, Trailers, Done, Aborted, Error };
+    enum class Framing { None, Length, Chunked, UntilClose };
+
+    State state;
+    Framing framing;
+    int status;                      // Numeric status code from the status line
+    int versionMinor;                // 0 for HTTP/1.0, 1 for HTTP/1.1
+    size_t remaining;                // Bytes left in the current body or chunk
+    size_t bytesReceived;            // Total bytes fed into this response
+    size_t decodedBytes;             // Body bytes handed to the sink or body()
+    string line;                     // Partially received header/chunk-size line
+    string bodyData;                 // De-chunked response body
+    map<string, string> headers;     // Header names are stored lowercase
+    BodySink bodySink;               // Receives the body when set
+    HeaderCheck headerCheck;         // Vetoes a response after its headers
+    ContentDecoder decoder;          // Undoes Content-Encoding between framing and sink
+
+    void appendBody(const char* data, size_t length);
+    void deliverBody(const char* data, size_t length);
+
+    bool parseStatusLine(const string& text);
+    bool parseHeaderLine(const string& text);
+    bool beginBody();
+    bool readLine(const char* data, size_t length, size_t& pos);
+};
+
+#endif
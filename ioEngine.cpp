@@ -0,0 +1,197 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  IoEngine Implementation
+ * ----------------------------------------------------------------------------
+ *  Each event loop keeps a list of sessions (one ClientSocket each), tops the
+ *  list up from the site source, waits for socket readiness or the nearest
+ *  timer, and advances every session that became ready or whose deadline
+ *  expired. A readiness model is used on both platforms so the same
+ *  ClientSocket state machine serves epoll and WSAPoll alike.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "ioEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+using namespace std::chrono;
+
+namespace {
+
+// Upper bound on a single wait so that newly discovered sites are picked up
+const int maxWaitMs = 250;
+
+}
+
+// ----------------------------------------------------------------------------
+// Poller
+// ----------------------------------------------------------------------------
+#ifdef _WIN32
+
+Poller::Poller() {}
+
+Poller::~Poller() {}
+
+void Poller::watch(SOCKET sock, bool forWrite, void* tag) {
+    watched[sock] = Watch{forWrite, tag};
+}
+
+void Poller::unwatch(SOCKET sock, void* tag) {
+    auto it = watched.find(sock);
+    if (it != watched.end() && it->second.tag == tag) watched.erase(it);
+}
+
+void Poller::wait(int timeoutMs, vector<void*>& ready) {
+    ready.clear();
+    if (watched.empty()) {
+        sleepMs(timeoutMs);
+        return;
+    }
+
+    vector<WSAPOLLFD> fds;
+    fds.reserve(watched.size());
+    for (const auto& entry : watched) {
+        WSAPOLLFD fd;
+        fd.fd = entry.first;
+        fd.events = entry.second.forWrite ? POLLWRNORM : POLLRDNORM;
+        fd.revents = 0;
+        fds.push_back(fd);
+    }
+
+    if (WSAPoll(fds.data(), (ULONG)fds.size(), timeoutMs) <= 0) return;
+
+    for (const auto& fd : fds) {
+        if (fd.revents != 0) ready.push_back(watched[fd.fd].tag);
+    }
+}
+
+#else
+
+Poller::Poller() : epollFd(epoll_create1(0)) {}
+
+Poller::~Poller() {
+    if (epollFd >= 0) close(epollFd);
+}
+
+void Poller::watch(SOCKET sock, bool forWrite, void* tag) {
+    struct epoll_event event;
+    event.events = forWrite ? EPOLLOUT : EPOLLIN;
+    event.data.ptr = tag;
+
+    // A closed descriptor leaves epoll on its own, so a reused number may
+    // need ADD where MOD was expected and vice versa
+    bool known = watched.count(sock) > 0;
+    if (epoll_ctl(epollFd, known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, sock, &event) != 0) {
+        epoll_ctl(epollFd, known ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, sock, &event);
+    }
+    watched[sock] = Watch{forWrite, tag};
+}
+
+void Poller::unwatch(SOCKET sock, void* tag) {
+    auto it = watched.find(sock);
+    if (it != watched.end() && it->second.tag == tag) {
+        watched.erase(it);
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, sock, nullptr);
+    }
+}
+
+void Poller::wait(int timeoutMs, vector<void*>& ready) {
+    ready.clear();
+    struct epoll_event events[256];
+    int count = epoll_wait(epollFd, events, 256, timeoutMs);
+    for (int i = 0; i < count; i++) {
+        ready.push_back(events[i].data.ptr);
+    }
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// AsyncEngine
+// ----------------------------------------------------------------------------
+AsyncEngine::AsyncEngine(int threads, int maxConnections, SiteSource source, SiteSink sink)
+    : threads(max(1, threads)), connectionsPerLoop(max(1, maxConnections / max(1, threads))),
+      source(source), sink(sink) {}
+
+void AsyncEngine::run() {
+    vector<thread> loops;
+    for (int i = 0; i < threads; i++) {
+        loops.push_back(thread(&AsyncEngine::eventLoop, this));
+    }
+    for (auto& loop : loops) {
+        loop.join();
+    }
+}
+
+// Advances one session and re-registers its socket for whatever it waits on next
+void AsyncEngine::step(Poller& poller, Session& session) {
+    session.wait = session.site->advance();
+    SOCKET sock = session.site->handle();
+    bool needsSocket = session.wait == IoWait::Read || session.wait == IoWait::Write;
+
+    if (session.watched != INVALID_SOCKET && (!needsSocket || session.watched != sock)) {
+        poller.unwatch(session.watched, &session);
+        session.watched = INVALID_SOCKET;
+    }
+    if (needsSocket) {
+        poller.watch(sock, session.wait == IoWait::Write, &session);
+        session.watched = sock;
+    }
+}
+
+void AsyncEngine::eventLoop() {
+    Poller poller;
+    list<Session> sessions;
+    vector<void*> ready;
+
+    while (true) {
+        // Top up with new sites; block only when this loop has nothing to do
+        while ((int)sessions.size() < connectionsPerLoop) {
+            int depth = 0;
+            ClientSocket* site = source(depth, sessions.empty());
+            if (!site) break;
+            site->setAsyncDns(true);
+
+            sessions.push_back(Session{unique_ptr<ClientSocket>(site), depth, IoWait::Timer, INVALID_SOCKET});
+            step(poller, sessions.back());
+        }
+
+        if (sessions.empty()) return;   // The source reported the end of the crawl
+
+        // Sleep until the nearest deadline, but never longer than maxWaitMs
+        auto now = steady_clock::now();
+        auto nearest = now + milliseconds(maxWaitMs);
+        for (const auto& session : sessions) {
+            if (session.wait != IoWait::Done) nearest = min(nearest, session.site->wakeTime());
+        }
+        int timeoutMs = (int)max<long long>(0, duration_cast<milliseconds>(nearest - now).count());
+
+        poller.wait(timeoutMs, ready);
+
+        // Ready sockets first, then anything whose timer or timeout expired
+        for (void* tag : ready) {
+            Session* session = static_cast<Session*>(tag);
+            if (session->wait != IoWait::Done) step(poller, *session);
+        }
+
+        now = steady_clock::now();
+        for (auto it = sessions.begin(); it != sessions.end(); ) {
+            if (it->wait != IoWait::Done && it->site->wakeTime() <= now) {
+                step(poller, *it);
+            }
+            if (it->wait == IoWait::Done) {
+                if (it->watched != INVALID_SOCKET) poller.unwatch(it->watched, &*it);
+                sink(*it->site, it->depth);
+                it = sessions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/*
+* ----------------------------------------------------------------------------
+ *  IoEngine Header - Event-Driven Asynchronous Crawling Engine
+ * ----------------------------------------------------------------------------
+ *  This header defines the asynchronous alternative to the thread-per-site
+ *  engine. A small, fixed number of event-loop threads each drive many
+ *  ClientSockets at once through their resumable advance() state machine,
+ *  waiting on readiness of all their sockets with a single system call.
+ *
+ *  Key Features:
+ *  - Poller abstraction: epoll on Linux, WSAPoll on Windows.
+ *  - Per-loop connection budget so hundreds of sites can be in flight.
+ *  - Crawl delays and I/O timeouts handled as timers, never as sleeps.
+ *  - Site hand-out and completion are delegated to callbacks so the engine
+ *    knows nothing about the crawler's global state.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef IOENGINE_H
+#define IOENGINE_H
+
+#include "clientSocket.h"
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+// Poller: readiness notification for a set of sockets
+// ----------------------------------------------------------------------------
+class Poller {
+public:
+    Poller();
+    ~Poller();
+
+    // Starts or updates watching a socket for readability or writability
+    void watch(SOCKET sock, bool forWrite, void* tag);
+
+    // Stops watching a socket registered with the given tag. A descriptor
+    // number reused by another session after a close is left alone.
+    void unwatch(SOCKET sock, void* tag);
+
+    // Waits up to timeoutMs and collects the tags of the ready sockets
+    void wait(int timeoutMs, vector<void*>& ready);
+
+private:
+    struct Watch {
+        bool forWrite;
+        void* tag;
+    };
+    map<SOCKET, Watch> watched;      // Currently registered sockets
+#ifndef _WIN32
+    int epollFd;                     // epoll instance backing this poller
+#endif
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+};
+
+// ----------------------------------------------------------------------------
+// AsyncEngine: a fixed pool of event loops multiplexing many sites
+// ----------------------------------------------------------------------------
+class AsyncEngine {
+public:
+    // Hands out the next site to crawl, or nullptr if none is available. When
+    // wait is true it blocks until a site arrives or the crawl has finished.
+    typedef function<ClientSocket*(int& depth, bool wait)> SiteSource;
+
+    // Receives a fully crawled site
+    typedef function<void(ClientSocket& site, int depth)> SiteSink;
+
+    AsyncEngine(int threads, int maxConnections, SiteSource source, SiteSink sink);
+
+    // Runs all event loops and returns once every one of them has drained
+    void run();
+
+private:
+    struct Session {
+        unique_ptr<ClientSocket> site;
+        int depth;
+        IoWait wait;                 // What the site is currently waiting for
+        SOCKET watched;              // Socket registered with the poller, if any
+    };
+
+    int threads;                     // Number of event-loop threads
+    int connectionsPerLoop;          // Concurrent sites driven by each loop
+    SiteSource source;
+    SiteSink sink;
+
+    void eventLoop();
+    void step(Poller& poller, Session& session);
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  Metrics Implementation
+ * ----------------------------------------------------------------------------
+ *  Bucket layout: values below 32 us get a bucket each; above that, every
+ *  power of two [2^m, 2^(m+1)) is split into 16 equal sub-buckets, and a
+ *  percentile is reported as the middle of its bucket.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "metrics.h"
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+const char* metricName(Metric metric) {
+    switch (metric) {
+    case Metric::Dns: return "DNS";
+    case Metric::Connect: return "Connect";
+    case Metric::Handshake: return "TLS Handshake";
+    case Metric::Send: return "Send";
+    case Metric::FirstByte: return "TTFB";
+    case Metric::Download: return "Download";
+    case Metric::Parse: return "Parse";
+    case Metric::FrontierInsert: return "Frontier Insert";
+    case Metric::StateLock: return "State Lock Wait";
+    default: return "?";
+    }
+}
+
+// ----------------------------------------------------------------------------
+// LatencyHistogram
+// ----------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram() : total(0) {
+    for (auto& bucket : buckets) bucket.store(0, memory_order_relaxed);
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other) : total(0) {
+    *this = other;
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+    for (int i = 0; i < bucketCount; i++) {
+        buckets[i].store(other.buckets[i].load(memory_order_relaxed), memory_order_relaxed);
+    }
+    total.store(other.total.load(memory_order_relaxed), memory_order_relaxed);
+    return *this;
+}
+
+int LatencyHistogram::bucketOf(uint64_t micros) {
+    const uint64_t largest = (1ULL << maxMagnitude) - 1;
+    if (micros > largest) micros = largest;
+    if (micros < 2 * subCount) return (int)micros;
+
+    int magnitude = 63 - __builtin_clzll(micros);
+    int sub = (int)(micros >> (magnitude - subBits)) & (subCount - 1);
+    return 2 * subCount + (magnitude - subBits - 1) * subCount + sub;
+}
+
+double LatencyHistogram::bucketValue(int index) {
+    if (index < 2 * subCount) return index;
+    int offset = index - 2 * subCount;
+    int shift = offset / subCount + 1;
+    double width = (double)(1ULL << shift);
+    double lower = (double)(subCount + offset % subCount) * width;
+    return lower + width / 2;
+}
+
+// Single writer: a plain load and store is enough and avoids a locked add
+void LatencyHistogram::record(uint64_t micros) {
+    atomic<uint32_t>& bucket = buckets[bucketOf(micros)];
+    bucket.store(bucket.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    total.store(total.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < bucketCount; i++) {
+        uint32_t added = other.buckets[i].load(memory_order_relaxed);
+        if (added) buckets[i].store(buckets[i].load(memory_order_relaxed) + added, memory_order_relaxed);
+    }
+    total.store(total.load(memory_order_relaxed) + other.total.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+double LatencyHistogram::percentile(double percent) const {
+    uint64_t samples = count();
+    if (samples == 0) return 0;
+
+    uint64_t target = (uint64_t)ceil(percent / 100.0 * (double)samples);
+    if (target < 1) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen >= target) return bucketValue(i);
+    }
+    return bucketValue(bucketCount - 1);
+}
+
+// ----------------------------------------------------------------------------
+// PageTimings
+// ----------------------------------------------------------------------------
+namespace {
+
+void printPercentiles(ostream& out, const char* indent, Metric metric, const LatencyHistogram& histogram) {
+    out << indent << metricName(metric) << ": "
+        << histogram.percentile(50) / 1000 << "ms / "
+        << histogram.percentile(90) / 1000 << "ms / "
+        << histogram.percentile(99) / 1000 << "ms (" << histogram.count() << ")\n";
+}
+
+}
+
+void PageTimings::print(ostream& out, const char* indent) const {
+    for (int i = 0; i < pageMetricCount; i++) {
+        if (phases[i].count() > 0) printPercentiles(out, indent, (Metric)i, phases[i]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Metrics
+// ----------------------------------------------------------------------------
+Metrics& Metrics::shared() {
+    static Metrics instance;
+    return instance;
+}
+
+// Registered once per thread; the registry owns it so that its samples
+// survive the thread
+Metrics::ThreadMetrics& Metrics::local() {
+    thread_local ThreadMetrics* metrics = nullptr;
+    if (!metrics) {
+        unique_ptr<ThreadMetrics> created(new ThreadMetrics());
+        metrics = created.get();
+        lock_guard<mutex> lock(registryMutex);
+        threads.push_back(move(created));
+    }
+    return *metrics;
+}
+
+void Metrics::record(Metric metric, uint64_t micros) {
+    local().histograms[(int)metric].record(micros);
+}
+
+vector<LatencyHistogram> Metrics::snapshot() const {
+    vector<LatencyHistogram> merged((int)Metric::Count);
+    lock_guard<mutex> lock(registryMutex);
+    for (const auto& metrics : threads) {
+        for (int i = 0; i < (int)Metric::Count; i++) merged[i].merge(metrics->histograms[i]);
+    }
+    return merged;
+}
+
+void Metrics::print(ostream& out) const {
+    vector<LatencyHistogram> merged = snapshot();
+    out << fixed << setprecision(3);
+    for (int i = 0; i < (int)Metric::Count; i++) {
+        if (merged[i].count() > 0) printPercentiles(out, "  ", (Metric)i, merged[i]);
+    }
+}
+
+void Metrics::startDump(int intervalSeconds) {
+    stop();
+    stopping = false;
+    dumper = thread(&Metrics::dumpLoop, this, intervalSeconds);
+}
+
+void Metrics::stop() {
+    if (!dumper.joinable()) return;
+    {
+        lock_guard<mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopSignal.notify_all();
+    dumper.join();
+}
+
+void Metrics::dumpLoop(int intervalSeconds) {
+    unique_lock<mutex> lock(stopMutex);
+    while (!stopSignal.wait_for(lock, chrono::seconds(intervalSeconds), [this] { return stopping; })) {
+        lock.unlock();
+        cerr << "Metrics (p50 / p90 / p99):\n";
+        print(cerr);
+        lock.lock();
+    }
+}
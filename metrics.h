@@ -0,0 +1,138 @@
+/*
+* ----------------------------------------------------------------------------
+ *  Metrics Header - Per-Phase Latency Histograms
+ * ----------------------------------------------------------------------------
+ *  This header defines the crawler's instrumentation: a log-bucketed
+ *  latency histogram in the style of HdrHistogram, and a process-wide
+ *  registry of per-thread histograms, one per crawl phase. Recording only
+ *  touches the calling thread's own buckets; the registry merges every
+ *  thread's histograms when a report is printed.
+ *
+ *  Key Features:
+ *  - 16 sub-buckets per power of two: about 6% relative error from 1 us
+ *    up to hours, in 2 KB per histogram.
+ *  - Recording is two relaxed loads and stores, with no locks and no
+ *    read-modify-write instructions (each thread writes only its own buckets).
+ *  - p50/p90/p99 and counts for each phase, per site and for the whole crawl.
+ *  - Optional periodic dump from a background thread while the crawl runs.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+using namespace std;
+
+// Timed phases of the crawl. The first ones make up a page fetch and are
+// also kept per site.
+enum class Metric {
+    Dns,            // Hostname resolution (cache hits included)
+    Connect,        // TCP connect
+    Handshake,      // TLS handshake
+    Send,           // Writing the request
+    FirstByte,      // Request sent until the first response byte
+    Download,       // First byte until the response is complete
+    Parse,          // Link extraction over the body
+    FrontierInsert, // Queuing a site on the frontier
+    StateLock,      // Waiting to acquire the crawler's stateMutex
+    Count
+};
+
+const int pageMetricCount = (int)Metric::Parse + 1;
+
+// Display name of a metric, e.g. "TTFB"
+const char* metricName(Metric metric);
+
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram& other);
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+
+    // Records one value in microseconds. Only one thread may record into
+    // a histogram at a time; any thread may read it meanwhile.
+    void record(uint64_t micros);
+
+    // Adds the counts of other into this histogram
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return total.load(memory_order_relaxed); }
+
+    // Value at the given percentile (0-100) in microseconds; 0 when empty
+    double percentile(double percent) const;
+
+private:
+    static const int subBits = 4;                        // 16 sub-buckets per power of two
+    static const int subCount = 1 << subBits;
+    static const int maxMagnitude = 40;                  // Values are capped at 2^40 us
+    static const int bucketCount = 2 * subCount + (maxMagnitude - subBits - 1) * subCount;
+
+    atomic<uint32_t> buckets[bucketCount];
+    atomic<uint64_t> total;
+
+    static int bucketOf(uint64_t micros);
+    static double bucketValue(int index);
+};
+
+// One histogram per page phase, kept per site by ClientSocket
+struct PageTimings {
+    LatencyHistogram phases[pageMetricCount];
+
+    // Prints "<name>: p50 / p90 / p99" lines for every phase with samples
+    void print(ostream& out, const char* indent) const;
+};
+
+class Metrics {
+public:
+    static Metrics& shared();
+
+    // Records a duration for the calling thread
+    void record(Metric metric, uint64_t micros);
+    void record(Metric metric, chrono::steady_clock::time_point start) {
+        auto elapsed = chrono::steady_clock::now() - start;
+        record(metric, (uint64_t)chrono::duration_cast<chrono::microseconds>(elapsed).count());
+    }
+
+    // Merges the histograms of every thread that recorded so far
+    vector<LatencyHistogram> snapshot() const;
+
+    // Prints one line per metric with samples: count, p50, p90 and p99
+    void print(ostream& out) const;
+
+    // Prints the merged metrics to stderr every intervalSeconds until stop()
+    void startDump(int intervalSeconds);
+    void stop();
+
+private:
+    struct ThreadMetrics {
+        LatencyHistogram histograms[(int)Metric::Count];
+    };
+
+    Metrics() : stopping(false) {}
+    ~Metrics() { stop(); }
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    mutable mutex registryMutex;     // Guards threads
+    vector<unique_ptr<ThreadMetrics>> threads;   // Kept after a thread exits
+
+    thread dumper;
+    mutex stopMutex;
+    condition_variable stopSignal;
+    bool stopping;
+
+    ThreadMetrics& local();
+    void dumpLoop(int intervalSeconds);
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  NetPlatform Implementation
+ * ----------------------------------------------------------------------------
+ *  Both backends sit side by side, selected by _WIN32. The network library
+ *  is held by a function-local static, so the first initNetwork() starts it
+ *  exactly once, even when several threads race, and process exit releases
+ *  it after every other socket user is gone. On POSIX, writing to a socket
+ *  the peer reset would raise SIGPIPE and kill the crawler, so the signal
+ *  is ignored and the failure comes back from send() like on Windows.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "netPlatform.h"
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+struct NetworkLibrary {
+    NetworkLibrary() {
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) throw runtime_error("Failed to initialize Winsock");
+#else
+        signal(SIGPIPE, SIG_IGN);
+#endif
+    }
+
+    ~NetworkLibrary() {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+};
+
+}
+
+void initNetwork() {
+    static NetworkLibrary library;
+}
+
+void sleepMs(int64_t milliseconds) {
+    if (milliseconds > 0) this_thread::sleep_for(chrono::milliseconds(milliseconds));
+}
+
+#ifdef _WIN32
+
+void closeSocket(SOCKET sock) {
+    closesocket(sock);
+}
+
+bool setNonBlocking(SOCKET sock) {
+    unsigned long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+}
+
+bool socketWouldBlock() {
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+}
+
+// A failed connect shows up in the exception set only
+SocketReady waitSocket(SOCKET sock, bool forWrite, int64_t timeoutMs) {
+    fd_set readySet, errorSet;
+    FD_ZERO(&readySet);
+    FD_ZERO(&errorSet);
+    FD_SET(sock, &readySet);
+    FD_SET(sock, &errorSet);
+    struct timeval tv;
+    tv.tv_sec = (long)(timeoutMs / 1000);
+    tv.tv_usec = (long)(timeoutMs % 1000) * 1000;
+
+    int result = forWrite ? select(0, NULL, &readySet, &errorSet, &tv) : select(0, &readySet, NULL, &errorSet, &tv);
+    if (result < 0 || FD_ISSET(sock, &errorSet)) return SocketReady::Error;
+    return result == 0 ? SocketReady::Timeout : SocketReady::Ready;
+}
+
+#else
+
+void closeSocket(SOCKET sock) {
+    close(sock);
+}
+
+bool setNonBlocking(SOCKET sock) {
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool socketWouldBlock() {
+    return errno == EWOULDBLOCK || errno == EAGAIN || errno == EINPROGRESS;
+}
+
+// POLLHUP alone is a readable end of stream; POLLERR is a failure, which
+// for a connect is also reported as SO_ERROR
+SocketReady waitSocket(SOCKET sock, bool forWrite, int64_t timeoutMs) {
+    struct pollfd fd;
+    fd.fd = sock;
+    fd.events = forWrite ? POLLOUT : POLLIN;
+    fd.revents = 0;
+
+    int result;
+    do {
+        result = poll(&fd, 1, (int)timeoutMs);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0 || (fd.revents & (POLLERR | POLLNVAL))) return SocketReady::Error;
+    return result == 0 ? SocketReady::Timeout : SocketReady::Ready;
+}
+
+#endif
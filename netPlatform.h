@@ -0,0 +1,85 @@
+/*
+* ----------------------------------------------------------------------------
+ *  NetPlatform Header - Portable Sockets and Timers
+ * ----------------------------------------------------------------------------
+ *  This header is the one place that includes the platform's socket API.
+ *  Winsock names (SOCKET, SOCKADDR_IN, INVALID_SOCKET, SOCKET_ERROR,
+ *  SD_BOTH) are the common vocabulary: on Windows they come from winsock2.h,
+ *  on Linux and other POSIX systems they are defined here over BSD sockets.
+ *  Everything that differs beyond names goes through the functions below.
+ *
+ *  Key Features:
+ *  - One-time, thread-safe network initialization per process
+ *    (WSAStartup on Windows, ignoring SIGPIPE on POSIX), released at exit.
+ *  - Non-blocking mode, close and "would block" checks for both APIs.
+ *  - Single-socket readiness waits on poll(), so POSIX descriptors above
+ *    FD_SETSIZE work; Windows keeps select(), which reports failed
+ *    connects reliably.
+ *  - Millisecond sleeps without Sleep() or usleep() at the call sites.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef NETPLATFORM_H
+#define NETPLATFORM_H
+
+#ifdef _WIN32
+
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600   // WSAPoll requires Windows Vista or later
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+
+#else
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+typedef struct sockaddr_in SOCKADDR_IN;
+typedef struct sockaddr SOCKADDR;
+
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define SD_BOTH SHUT_RDWR
+
+#endif
+
+#include <cstdint>
+
+// Readiness of a socket after waitSocket()
+enum class SocketReady {
+    Timeout,
+    Ready,      // Readable or writable as asked (a closed peer reads as ready)
+    Error       // Failed, e.g. a refused connect
+};
+
+// Starts the socket library on first use; later calls return at once.
+// Throws runtime_error when the platform refuses.
+void initNetwork();
+
+void closeSocket(SOCKET sock);
+
+bool setNonBlocking(SOCKET sock);
+
+// The last socket call failed only because it would block, or because a
+// non-blocking connect is under way
+bool socketWouldBlock();
+
+// Waits up to timeoutMs (0 polls) for sock to become readable, or writable
+// when forWrite is set
+SocketReady waitSocket(SOCKET sock, bool forWrite, int64_t timeoutMs);
+
+void sleepMs(int64_t milliseconds);
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  PageFrontier Implementation
+ * ----------------------------------------------------------------------------
+ *  The heap is a 4-ary max-heap on (score, earliest arrival): shallower than
+ *  a binary heap, and the four children of a node sit next to each other.
+ *  Every move of an entry updates its slot, so an in-link finds the entry
+ *  in O(1) and re-sifts it in O(log n). While pages wait in the spill tail,
+ *  new pages join the tail as well; the heap is only refilled from it once
+ *  empty, which keeps FIFO order exact when nothing is weighted.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "pageFrontier.h"
+#include "urlSet.h"
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+
+const char* const featureNames[(int)FrontierScorer::Feature::Count] = {"inlinks", "depth", "length"};
+
+// "/" is 0, "/a" and "/a/" are 1, "/a/b?c=/d" is 2
+int pathDepth(string_view path) {
+    path = path.substr(0, path.find('?'));
+    int depth = 0;
+    for (size_t i = 0; i + 1 < path.size(); i++) {
+        if (path[i] == '/' && path[i + 1] != '/') depth++;
+    }
+    return depth;
+}
+
+}
+
+// ----------------------------------------------------------------------------
+// FrontierScorer
+// ----------------------------------------------------------------------------
+FrontierScorer& FrontierScorer::shared() {
+    static FrontierScorer scorer;
+    return scorer;
+}
+
+vector<string> FrontierScorer::defaultTerms() {
+    return {"inlinks=1", "depth=-1", "length=-0.01"};
+}
+
+vector<double> FrontierScorer::parseTerms(const vector<string>& terms) {
+    vector<double> parsed((int)Feature::Count, 0.0);
+    for (const string& term : terms) {
+        size_t equals = term.find('=');
+        string name = term.substr(0, equals);
+        int feature = 0;
+        while (feature < (int)Feature::Count && name != featureNames[feature]) feature++;
+        if (feature == (int)Feature::Count) throw runtime_error("Unknown frontier score feature " + name);
+
+        char* end = nullptr;
+        const char* weight = equals == string::npos ? "" : term.c_str() + equals + 1;
+        parsed[feature] = strtod(weight, &end);
+        if (end == weight || *end != '\0') throw runtime_error("Frontier score term " + term + " needs a numeric weight");
+    }
+    return parsed;
+}
+
+FrontierScorer::FrontierScorer() : weights((int)Feature::Count, 0.0), weighted(false) {}
+
+void FrontierScorer::configure(const vector<string>& terms) {
+    weights = parseTerms(terms);
+    weighted = false;
+    for (double weight : weights) weighted = weighted || weight != 0;
+}
+
+double FrontierScorer::score(int inlinks, int depth, size_t length) const {
+    return weights[(int)Feature::Inlinks] * inlinks + weights[(int)Feature::Depth] * depth +
+           weights[(int)Feature::Length] * (double)length;
+}
+
+double FrontierScorer::page(string_view path, int inlinks) const {
+    if (!weighted) return 0;
+    return score(inlinks, pathDepth(path), path.size());
+}
+
+// ----------------------------------------------------------------------------
+// PageFrontier
+// ----------------------------------------------------------------------------
+PageFrontier::PageFrontier(size_t memoryBudget)
+    : overflow(memoryBudget - memoryBudget / 2), heapBudget(memoryBudget ? max<size_t>(1, memoryBudget / 2) : 0),
+      heapBytes(0), nextSequence(0) {}
+
+size_t PageFrontier::entryBytes(const Entry& entry) {
+    return sizeof(Entry) + entry.path.size() + 4 * sizeof(void*);   // Slot map node included
+}
+
+bool PageFrontier::before(const Entry& a, const Entry& b) const {
+    if (a.score != b.score) return a.score > b.score;
+    return a.sequence < b.sequence;
+}
+
+void PageFrontier::place(size_t index, Entry&& entry) {
+    heap[index] = move(entry);
+    slots[heap[index].fingerprint] = index;
+}
+
+void PageFrontier::siftUp(size_t index) {
+    Entry moving = move(heap[index]);
+    while (index > 0) {
+        size_t parent = (index - 1) / arity;
+        if (!before(moving, heap[parent])) break;
+        place(index, move(heap[parent]));
+        index = parent;
+    }
+    place(index, move(moving));
+}
+
+void PageFrontier::siftDown(size_t index) {
+    Entry moving = move(heap[index]);
+    size_t count = heap.size();
+    while (true) {
+        size_t first = index * arity + 1;
+        if (first >= count) break;
+        size_t best = first;
+        for (size_t child = first + 1; child < first + arity && child < count; child++) {
+            if (before(heap[child], heap[best])) best = child;
+        }
+        if (!before(heap[best], moving)) break;
+        place(index, move(heap[best]));
+        index = best;
+    }
+    place(index, move(moving));
+}
+
+void PageFrontier::insert(string_view path) {
+    Entry entry;
+    entry.path = string(path);
+    entry.inlinks = 1;
+    entry.score = FrontierScorer::shared().page(path, entry.inlinks);
+    entry.sequence = nextSequence++;
+    entry.fingerprint = fingerprint64(path);
+    heapBytes += entryBytes(entry);
+
+    heap.push_back(move(entry));
+    siftUp(heap.size() - 1);
+}
+
+void PageFrontier::push(string_view path) {
+    if (!overflow.empty() || (heapBudget > 0 && heapBytes >= heapBudget)) overflow.push(path);
+    else insert(path);
+}
+
+void PageFrontier::addInlink(string_view path) {
+    const FrontierScorer& scorer = FrontierScorer::shared();
+    if (!scorer.ordered()) return;
+
+    uint64_t fingerprint = fingerprint64(path);
+    auto slot = slots.find(fingerprint);
+    if (slot == slots.end() || heap[slot->second].path != path) return;
+
+    Entry& entry = heap[slot->second];
+    entry.inlinks++;
+    entry.score = scorer.page(path, entry.inlinks);
+    siftUp(slot->second);
+    siftDown(slots[fingerprint]);    // For a negative in-link weight
+}
+
+void PageFrontier::refill() {
+    string path;
+    int depth;
+    while ((heapBudget == 0 || heapBytes < heapBudget) && overflow.pop(path, depth)) insert(path);
+}
+
+bool PageFrontier::pop(string& path) {
+    if (heap.empty()) refill();
+    if (heap.empty()) return false;
+
+    Entry& top = heap.front();
+    auto slot = slots.find(top.fingerprint);
+    if (slot != slots.end() && slot->second == 0) slots.erase(slot);
+    heapBytes -= entryBytes(top);
+    path = move(top.path);
+
+    if (heap.size() > 1) {
+        heap.front() = move(heap.back());
+        heap.pop_back();
+        siftDown(0);
+    } else {
+        heap.pop_back();
+    }
+    return true;
+}
+
+void PageFrontier::clear() {
+    heap.clear();
+    slots.clear();
+    overflow.clear();
+    heapBytes = 0;
+}
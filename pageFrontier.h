@@ -0,0 +1,124 @@
+/*
+* ----------------------------------------------------------------------------
+ *  PageFrontier Header - Best-First Queue of a Site's Pending Pages
+ * ----------------------------------------------------------------------------
+ *  This header defines FrontierScorer, the weighted features that rank
+ *  pending pages and linked sites, and PageFrontier, the priority queue of
+ *  a site's pages still to be crawled. With a page limit, the pages fetched
+ *  are then the most valuable ones found so far rather than the ones that
+ *  happened to come first in the HTML.
+ *
+ *  Key Features:
+ *  - Pluggable scoring: a weighted sum of named features ("inlinks",
+ *    "depth", "length"), configured as "name=weight" terms. No terms give
+ *    plain FIFO order.
+ *  - Indexed 4-ary heap: a page linked again while it waits gains an
+ *    in-link and moves up in place, without a second queue entry.
+ *  - Ties are broken by arrival, so equal pages keep FIFO order.
+ *  - Memory bounded like SpillQueue: pages past the budget wait in a
+ *    disk-spilling FIFO tail and join the heap once it has drained.
+ *  - Not thread-safe; callers guard it with their own lock.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef PAGEFRONTIER_H
+#define PAGEFRONTIER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "spillQueue.h"
+
+using namespace std;
+
+class FrontierScorer {
+public:
+    enum class Feature {
+        Inlinks,    // Links to the page (or site) seen so far
+        Depth,      // Path segments of the page ("/a/b" is 2); 0 for sites
+        Length,     // Bytes of the path (or hostname)
+        Count
+    };
+
+    static FrontierScorer& shared();
+
+    static vector<string> defaultTerms();
+
+    // Parses "name=weight" terms; throws runtime_error on an unknown feature
+    // or a malformed weight
+    static vector<double> parseTerms(const vector<string>& terms);
+
+    // Must be called before crawling starts: scoring takes no lock
+    void configure(const vector<string>& terms);
+
+    // Some feature has a weight, i.e. the order is not plain FIFO
+    bool ordered() const { return weighted; }
+
+    // Higher scores are crawled first
+    double score(int inlinks, int depth, size_t length) const;
+    double page(string_view path, int inlinks) const;
+    double site(string_view hostname, int inlinks) const { return score(inlinks, 0, hostname.size()); }
+
+    FrontierScorer(const FrontierScorer&) = delete;
+    FrontierScorer& operator=(const FrontierScorer&) = delete;
+
+private:
+    vector<double> weights;          // One per Feature
+    bool weighted;
+
+    FrontierScorer();
+};
+
+class PageFrontier {
+public:
+    // memoryBudget is in bytes, shared by the heap and the spill tail; 0
+    // keeps everything in the heap
+    explicit PageFrontier(size_t memoryBudget = 0);
+
+    void push(string_view path);
+
+    // A link to path was seen again; moves it up when it is still waiting
+    // in the heap (pages in the spill tail or already taken are left alone)
+    void addInlink(string_view path);
+
+    // Removes the best page; returns false when the frontier is empty
+    bool pop(string& path);
+
+    void clear();
+
+    bool empty() const { return size() == 0; }
+    size_t size() const { return heap.size() + overflow.size(); }
+
+private:
+    struct Entry {
+        string path;
+        double score;
+        uint64_t sequence;           // Arrival order, breaks ties
+        uint64_t fingerprint;        // Key of slots
+        int inlinks;
+    };
+
+    static const size_t arity = 4;
+
+    vector<Entry> heap;
+    unordered_map<uint64_t, size_t> slots;   // Fingerprint of a page -> its heap index
+    SpillQueue overflow;             // FIFO tail past the heap's budget
+    size_t heapBudget;               // Bytes of heap entries, 0 for no limit
+    size_t heapBytes;
+    uint64_t nextSequence;
+
+    void insert(string_view path);
+    void refill();
+    bool before(const Entry& a, const Entry& b) const;
+    void place(size_t index, Entry&& entry);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+    static size_t entryBytes(const Entry& entry);
+
+    PageFrontier(const PageFrontier&) = delete;
+    PageFrontier& operator=(const PageFrontier&) = delete;
+};
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  PageScheduler Implementation
+ * ----------------------------------------------------------------------------
+ *  Every page task ends by calling schedulePages(), which tops the site up
+ *  to as many tasks as there are pages and connection slots. The task that
+ *  finds no page pending and no other task running reports the site, so a
+ *  site is reported exactly once however its tasks interleave.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "pageScheduler.h"
+#include <algorithm>
+
+PageScheduler::PageScheduler(ThreadPool& pool, int slowHostMs, FinishHandler onFinished)
+    : pool(pool), slowHostMs(slowHostMs), onFinished(move(onFinished)) {}
+
+void PageScheduler::start(unique_ptr<ClientSocket> site, int depth) {
+    shared_ptr<SiteCrawl> crawl = make_shared<SiteCrawl>();
+    crawl->site = move(site);
+    crawl->depth = depth;
+    schedulePages(crawl, false);
+}
+
+// finishedTask is true when called by a page task that just ended
+void PageScheduler::schedulePages(shared_ptr<SiteCrawl> crawl, bool finishedTask) {
+    int spawn = 0;
+    bool finished = false;
+    {
+        lock_guard<mutex> lock(crawl->crawlMutex);
+        if (finishedTask) crawl->pageTasks--;
+
+        if (crawl->pageTasks == 0 && crawl->site->isFinished()) {
+            finished = !crawl->reported;
+            crawl->reported = true;
+        } else {
+            int slots = crawl->site->getBudget().maxActive() - crawl->pageTasks;
+            // A slow host keeps a single page task, so it cannot tie up
+            // several workers while faster hosts wait
+            if (slowHostMs > 0 && crawl->site->currentResponseTime() > slowHostMs) {
+                slots = min(slots, 1 - crawl->pageTasks);
+            }
+            spawn = max(0, min(slots, crawl->site->pagesAvailable()));
+            crawl->pageTasks += spawn;
+        }
+    }
+
+    if (finished) onFinished(*crawl->site, crawl->depth);
+    for (int i = 0; i < spawn; i++) {
+        pool.submit([this, crawl] { crawlPage(crawl); });
+    }
+}
+
+void PageScheduler::crawlPage(shared_ptr<SiteCrawl> crawl) {
+    ClientSocket& site = *crawl->site;
+    HostBudget& budget = site.getBudget();
+
+    // Not yet allowed to hit this host: park the task until the budget
+    // refills and let the worker fetch pages of other hosts meanwhile
+    HostBudget::TimePoint retryAt;
+    if (!budget.tryAcquire(retryAt)) {
+        pool.submitAt(retryAt, [this, crawl] { crawlPage(crawl); });
+        return;
+    }
+
+    string path;
+    if (site.takePage(path)) {
+        // Pages pipelined behind this one ride on the same budget slot
+        unique_ptr<HostConnection> connection = site.acquireConnection();
+        connection->start(path, site.pipelineBatch(*connection));
+        do {
+            connection->wait();
+            site.completePage(*connection);
+        } while (connection->startNext());
+        budget.release();
+        site.returnUnanswered(*connection);
+        site.releaseConnection(move(connection));
+    } else {
+        // Nothing was requested, so the token is not spent either
+        budget.release();
+        budget.refund(1);
+    }
+
+    schedulePages(crawl, true);
+}
@@ -0,0 +1,62 @@
+/*
+* ----------------------------------------------------------------------------
+ *  PageScheduler Header - Page Tasks of Sites on the Worker Pool
+ * ----------------------------------------------------------------------------
+ *  This header defines the PageScheduler class, which crawls sites page by
+ *  page on a ThreadPool for the blocking engine. It is shared by the
+ *  crawler and the crawl benchmark, so both run the same scheduling.
+ *
+ *  Key Features:
+ *  - Up to the host's connection budget of page tasks run for a site at
+ *    any time; a site is handed back once nothing is pending or in flight.
+ *  - A page not yet allowed by the host's budget is parked on the pool's
+ *    timer heap, so the worker moves on to pages of other hosts.
+ *  - Pages pipelined behind a request ride on its budget slot, and pages
+ *    the host left unanswered are queued again.
+ *  - Hosts slower than slowHostMs keep a single page task.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef PAGESCHEDULER_H
+#define PAGESCHEDULER_H
+
+#include "clientSocket.h"
+#include "threadPool.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+class PageScheduler {
+public:
+    // Called once per site, on a worker, after its last page task ended
+    typedef function<void(ClientSocket& site, int depth)> FinishHandler;
+
+    // slowHostMs 0 never limits a host to one page task
+    PageScheduler(ThreadPool& pool, int slowHostMs, FinishHandler onFinished);
+
+    // Starts crawling site; the scheduler owns it until onFinished returned
+    void start(unique_ptr<ClientSocket> site, int depth);
+
+    PageScheduler(const PageScheduler&) = delete;
+    PageScheduler& operator=(const PageScheduler&) = delete;
+
+private:
+    struct SiteCrawl {
+        unique_ptr<ClientSocket> site;
+        int depth;
+        mutex crawlMutex;
+        int pageTasks{0};             // Page tasks submitted and not yet finished
+        bool reported{false};         // Site results already handed to onFinished
+    };
+
+    ThreadPool& pool;
+    int slowHostMs;
+    FinishHandler onFinished;
+
+    void schedulePages(shared_ptr<SiteCrawl> crawl, bool finishedTask);
+    void crawlPage(shared_ptr<SiteCrawl> crawl);
+};
+
+#endif
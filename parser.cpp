@@ -7,22 +7,32 @@
  *  - Extracting URLs from an HTML response.
  *  - Validating URLs to ensure they are of the correct type and domain.
  *  - Handling LinkedList operations for storing discovered URLs.
+ *  - Streaming link extraction over page chunks (LinkExtractor).
  *
  *  Optimizations include:
  *  - Static string constants to reduce string creation
  *  - Efficient string operations
  *  - Improved memory management
+ *  - Single-pass link extraction with a 256-entry character table, and an
+ *    SSE2/AVX2 scan (scalar fallback) that skips text between candidates
+ *  - Domain and file type checks through configurable suffix tries (see
+ *    urlFilter.h)
  * ----------------------------------------------------------------------------
  */
 
 #include "parser.h"
+#include "urlFilter.h"
 #include <map>
 #include <stdexcept>
-#include <array>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // LinkedList member function implementations
-void LinkedList::add(string url, string metadata) {
-    Node* newNode = new Node(url, metadata);
+void LinkedList::append(Node* newNode) {
     if (!head) {
         head = tail = newNode;
     } else {
@@ -57,9 +67,9 @@ void LinkedList::pop() {
 }
 
 // URL Processing Functions
-string getHostnameFromUrl(const string& url) {
-    static const string https = "https://";
-    static const string http = "http://";
+string_view getHostnameFromUrl(string_view url) {
+    static const string_view https = "https://";
+    static const string_view http = "http://";
 
     size_t offset = 0;
     if (url.compare(0, https.length(), https) == 0)
@@ -68,12 +78,12 @@ string getHostnameFromUrl(const string& url) {
         offset = http.length();
 
     size_t pos = url.find('/', offset);
-    return url.substr(offset, pos == string::npos ? string::npos : pos - offset);
+    return url.substr(offset, pos == string_view::npos ? string_view::npos : pos - offset);
 }
 
-string getHostPathFromUrl(const string& url) {
-    static const string https = "https://";
-    static const string http = "http://";
+string_view getHostPathFromUrl(string_view url) {
+    static const string_view https = "https://";
+    static const string_view http = "http://";
 
     size_t offset = 0;
     if (url.compare(0, https.length(), https) == 0)
@@ -82,86 +92,186 @@ string getHostPathFromUrl(const string& url) {
         offset = http.length();
 
     size_t pos = url.find('/', offset);
-    if (pos == string::npos) return "/";
+    if (pos == string_view::npos) return "/";
 
-    string path = url.substr(pos);
+    // Collapse a run of leading slashes into one
+    string_view path = url.substr(pos);
     pos = path.find_first_not_of('/');
-    return pos == string::npos ? "/" : path.erase(0, pos - 1);
+    return pos == string_view::npos ? "/" : path.substr(pos - 1);
+}
+
+// Single pass over the raw text; see LinkExtractor
+UrlList extractUrls(const string& httpText) {
+    LinkExtractor extractor;
+    extractor.feed(httpText.data(), httpText.size());
+    return extractor.links();
+}
+
+// LinkExtractor member function implementations
+namespace {
+
+const char* const linkPatterns[] = {"href=\"", "href = \"", "http://", "https://"};
+const size_t linkPatternLengths[] = {6, 8, 7, 8};
+
+// Filtered, lowercase view of the text used for matching: the same
+// character set as reformatHttpResponse, looked up in a flat table.
+// 0 means the character is dropped.
+struct FilterTable {
+    char map[256];
+    bool urlEnd[256];
+
+    FilterTable() {
+        static const string allowedChrs = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789.,/\":#?+-_= ";
+        static const string urlEndChars = "\"#?, ";
+        for (int i = 0; i < 256; i++) {
+            map[i] = 0;
+            urlEnd[i] = false;
+        }
+        for (char ch : allowedChrs) map[(unsigned char)ch] = (char)tolower(ch);
+        map[(unsigned char)'\n'] = ' ';
+        for (char ch : urlEndChars) urlEnd[(unsigned char)ch] = true;
+    }
+};
+
+const FilterTable& filterTable() {
+    static const FilterTable table;
+    return table;
+}
+
+}
+
+void LinkExtractor::reset() {
+    for (auto& state : states) {
+        state.matched = 0;
+        state.capturing = false;
+        state.url.clear();
+    }
+    idle = true;
+    extracted.clear();
+    secure.clear();
+}
+
+// Returns the offset of the first 'h' or 'H' at or after pos, or length.
+// Every pattern starts with 'h', so while no match is in progress all other
+// bytes can be skipped wholesale; this is where the vector units help.
+static size_t findPatternStart(const char* data, size_t pos, size_t length) {
+#if defined(__AVX2__)
+    const __m256i lower = _mm256_set1_epi8('h');
+    const __m256i upper = _mm256_set1_epi8('H');
+    while (pos + 32 <= length) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(data + pos));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, lower), _mm256_cmpeq_epi8(block, upper));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hits);
+        if (mask) return pos + __builtin_ctz(mask);
+        pos += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i lower = _mm_set1_epi8('h');
+    const __m128i upper = _mm_set1_epi8('H');
+    while (pos + 16 <= length) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(data + pos));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, lower), _mm_cmpeq_epi8(block, upper));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+        if (mask) return pos + __builtin_ctz(mask);
+        pos += 16;
+    }
+#endif
+    while (pos < length && (data[pos] | 0x20) != 'h') pos++;
+    return pos;
+}
+
+void LinkExtractor::feed(const char* data, size_t length) {
+    const FilterTable& table = filterTable();
+    size_t i = 0;
+
+    while (i < length) {
+        if (idle) {
+            i = findPatternStart(data, i, length);
+            if (i == length) break;
+        }
+        char ch = table.map[(unsigned char)data[i++]];
+        if (ch) consume(ch);
+    }
 }
 
-LinkedList extractUrls(const string& httpText) {
-    string httpRaw = reformatHttpResponse(httpText);
-    static const array<string, 4> urlStart = {"href=\"", "href = \"", "http://", "https://"};
-    static const string urlEndChars = "\"#?, ";
-    LinkedList extractedUrls;
+void LinkExtractor::consume(char ch) {
+    const FilterTable& table = filterTable();
 
-    for (const auto& startText : urlStart) {
-        size_t pos = 0;
-        while ((pos = httpRaw.find(startText, pos)) != string::npos) {
-            pos += startText.length();
-            size_t endPos = httpRaw.find_first_of(urlEndChars, pos);
-            if (endPos == string::npos) break;
+    for (int i = 0; i < patternCount; i++) {
+        PatternState& state = states[i];
 
-            string url = httpRaw.substr(pos, endPos - pos);
-            if (verifyUrl(url)) {
-                extractedUrls.add(getHostnameFromUrl(url), getHostPathFromUrl(url));
+        if (state.capturing) {
+            if (table.urlEnd[(unsigned char)ch]) {
+                emit(state.url, i == patternCount - 1);
+                state.capturing = false;
+                state.url.clear();
+            } else if (state.url.size() < maxUrlLength) {
+                state.url += ch;
+            } else {
+                state.capturing = false;   // Overlong URL, drop it
+                state.url.clear();
             }
-            pos = endPos;
+            continue;
+        }
+
+        // None of the patterns has a border, so a mismatch restarts at 0 or 1
+        const char* pattern = linkPatterns[i];
+        if (ch == pattern[state.matched]) {
+            if (++state.matched == linkPatternLengths[i]) {
+                state.matched = 0;
+                state.capturing = true;
+            }
+        } else {
+            state.matched = (ch == pattern[0]) ? 1 : 0;
         }
     }
-    return extractedUrls;
+
+    idle = true;
+    for (const auto& state : states) {
+        if (state.matched != 0 || state.capturing) idle = false;
+    }
 }
 
-bool verifyUrl(const string& url) {
+// https is set when the URL followed the https:// pattern, which is not
+// part of the captured text
+void LinkExtractor::emit(string_view url, bool https) {
+    if (verifyUrl(url)) {
+        string_view host = getHostnameFromUrl(url);
+        extracted.add(host, getHostPathFromUrl(url));
+        if (https || url.compare(0, 8, "https://") == 0) secure.add(host, "");
+    }
+}
+
+bool verifyUrl(string_view url) {
     if (url.empty()) return false;
-    string urlDomain = getHostnameFromUrl(url);
+    string_view urlDomain = getHostnameFromUrl(url);
     if (urlDomain.empty() || !verifyDomain(urlDomain)) return false;
     if (!verifyType(url)) return false;
-    if (url.find("mailto:") != string::npos) return false;
+    if (url.find("mailto:") != string_view::npos) return false;
     return true;
 }
 
-bool verifyType(const string& url) {
-    static const array<string, 7> forbiddenTypes = {
-        ".css", ".js", ".pdf", ".png", ".jpeg", ".jpg", ".ico"
-    };
-
-    for (const auto& type : forbiddenTypes)
-        if (url.find(type) != string::npos) return false;
-    return true;
+bool verifyType(string_view url) {
+    return !UrlFilter::shared().blocksType(url);
 }
 
-bool verifyDomain(const string& url) {
-    static const array<string, 7> allowedDomains = {
-        ".com", ".pk", ".edu", ".net", ".co", ".org", ".me"
-    };
-
-    for (const auto& domain : allowedDomains)
-        if (hasSuffix(url, domain)) return true;
-    return false;
+bool verifyDomain(string_view url) {
+    return UrlFilter::shared().allowsDomain(url);
 }
 
-bool hasSuffix(const string& str, const string& suffix) {
+bool hasSuffix(string_view str, string_view suffix) {
     return str.size() >= suffix.size() &&
            str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
 }
 
 string reformatHttpResponse(const string& text) {
-    static const string allowedChrs = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789.,/\":#?+-_= ";
-    static const map<char, char> charMap = []() {
-        map<char, char> m;
-        for (char ch : allowedChrs) m[ch] = ch;
-        m['\n'] = ' ';
-        return m;
-    }();
+    const FilterTable& table = filterTable();
 
     string result;
     result.reserve(text.length());
     for (char ch : text) {
-        auto it = charMap.find(ch);
-        if (it != charMap.end()) {
-            result += tolower(it->second);
-        }
+        char mapped = table.map[(unsigned char)ch];
+        if (mapped) result += mapped;
     }
     return result;
-}
\ No newline at end of file
+}
@@ -4,8 +4,10 @@
  * ----------------------------------------------------------------------------
  *  This header defines the core data structures and functions used for URL
  *  processing in the web crawler. It includes:
- *  - Queue template class for efficient FIFO operations
+ *  - Queue template class, a bounded lock-free MPMC FIFO
  *  - LinkedList class for URL storage and management
+ *  - LinkExtractor class for streaming link extraction from page chunks
+ *    into arena-backed UrlLists (see urlArena.h)
  *  - URL parsing and validation functions
  *
  *  The implementations focus on memory safety, efficiency, and proper resource
@@ -17,8 +19,14 @@
 #define PARSER_H
 
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <map>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include "urlArena.h"
 
 using namespace std;
 
@@ -36,108 +44,100 @@ struct Node {
     Node* next;        // Pointer to the next node in the list
 
     // Constructor to initialize the URL, metadata, and set the next pointer to nullptr
-    Node(string u, string m) : url(u), metadata(m), next(nullptr) {}
+    Node(string u, string m) : url(move(u)), metadata(move(m)), next(nullptr) {}
 };
 
 // ----------------------------------------------------------------------------
-// Queue template class for efficient FIFO operations
+// Queue template class: bounded lock-free multi-producer/multi-consumer FIFO
 // ----------------------------------------------------------------------------
+// A ring of cells, each tagged with a sequence number that tells producers
+// and consumers whose turn it is (after D. Vyukov's bounded MPMC queue).
+// push and pop claim a position with one compare-and-swap and never block
+// or allocate: the ring itself is the node pool, allocated once.
 template<typename T>
 class Queue {
 private:
-    // Internal node structure for the queue
-    struct QNode {
-        T data;
-        QNode* next;
-        QNode(const T& value) : data(value), next(nullptr) {}
+    struct Cell {
+        atomic<size_t> sequence;     // == position: free for the producer of position
+        T data;                      // == position + 1: filled for its consumer
     };
-    
-    QNode* front;       // Pointer to front of queue
-    QNode* rear;        // Pointer to rear of queue
-    size_t size_;       // Current size of queue
+
+    unique_ptr<Cell[]> cells;        // Ring of capacity() cells
+    size_t mask;                     // capacity() - 1
+
+    // Producers and consumers each get their own cache line
+    alignas(64) atomic<size_t> enqueuePos;
+    alignas(64) atomic<size_t> dequeuePos;
 
 public:
-    // Constructor initializes an empty queue
-    Queue() : front(nullptr), rear(nullptr), size_(0) {}
-    
-    // Deep copy constructor ensures proper resource management
-    Queue(const Queue& other) : front(nullptr), rear(nullptr), size_(0) {
-        QNode* curr = other.front;
-        while (curr) {
-            push(curr->data);
-            curr = curr->next;
-        }
+    // Capacity is rounded up to a power of two
+    explicit Queue(size_t capacity = 1024) : enqueuePos(0), dequeuePos(0) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++) cells[i].sequence.store(i, memory_order_relaxed);
     }
-    
-    // Assignment operator with proper cleanup and deep copy
-    Queue& operator=(const Queue& other) {
-        if (this != &other) {
-            // Clear existing queue
-            while (!empty()) {
-                pop();
-            }
-            
-            // Copy from other queue
-            QNode* curr = other.front;
-            while (curr) {
-                push(curr->data);
-                curr = curr->next;
+
+    // Adds an element to the rear of the queue; returns false when full,
+    // in which case value is left untouched
+    template<typename U>
+    bool push(U&& value) {
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    cell.data = std::forward<U>(value);
+                    cell.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;            // The consumer of the previous lap is behind
+            } else {
+                pos = enqueuePos.load(memory_order_relaxed);
             }
         }
-        return *this;
     }
-    
-    // Destructor ensures proper cleanup
-    ~Queue() {
-        while (!empty()) {
-            pop();
-        }
-    }
-    
-    // Adds an element to the rear of the queue
-    void push(const T& value) {
-        QNode* newNode = new QNode(value);
-        if (empty()) {
-            front = rear = newNode;
-        } else {
-            rear->next = newNode;
-            rear = newNode;
+
+    // Removes the front element into value; returns false when empty
+    bool pop(T& value) {
+        size_t pos = dequeuePos.load(memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    value = std::move(cell.data);
+                    cell.data = T();     // Release what the element owned now
+                    cell.sequence.store(pos + mask + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos.load(memory_order_relaxed);
+            }
         }
-        size_++;
-    }
-    
-    // Removes the front element from the queue
-    void pop() {
-        if (empty()) return;
-        
-        QNode* temp = front;
-        front = front->next;
-        if (!front) rear = nullptr;
-        delete temp;
-        size_--;
-    }
-    
-    // Returns reference to front element
-    T& peek() {
-        if (empty()) throw std::runtime_error("Queue is empty");
-        return front->data;
-    }
-    
-    // Returns const reference to front element
-    const T& peek() const {
-        if (empty()) throw std::runtime_error("Queue is empty");
-        return front->data;
-    }
-    
-    // Checks if queue is empty
-    bool empty() const {
-        return front == nullptr;
     }
-    
-    // Returns current size of queue
+
+    // Snapshot only: other threads may change the queue right after
+    bool empty() const { return size() == 0; }
     size_t size() const {
-        return size_;
+        size_t tail = enqueuePos.load(memory_order_acquire);
+        size_t head = dequeuePos.load(memory_order_acquire);
+        return tail > head ? tail - head : 0;
     }
+
+    size_t capacity() const { return mask + 1; }
+
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
 };
 
 // ----------------------------------------------------------------------------
@@ -162,6 +162,12 @@ public:
         }
     }
     
+    // Move constructor takes over the nodes without copying any string
+    LinkedList(LinkedList&& other) noexcept : head(other.head), tail(other.tail), size_(other.size_) {
+        other.head = other.tail = nullptr;
+        other.size_ = 0;
+    }
+
     // Assignment operator
     LinkedList& operator=(const LinkedList& other) {
         if (this != &other) {
@@ -175,11 +181,31 @@ public:
         return *this;
     }
     
+    // Move assignment
+    LinkedList& operator=(LinkedList&& other) noexcept {
+        if (this != &other) {
+            clear();
+            head = other.head;
+            tail = other.tail;
+            size_ = other.size_;
+            other.head = other.tail = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
     // Destructor ensures proper cleanup
     ~LinkedList() { clear(); }
     
-    // Adds a new URL with metadata to the list
-    void add(string url, string metadata);
+    // Adds a new URL with metadata to the list; rvalue arguments are moved
+    // into the node, so add(move(url), move(meta)) copies nothing
+    void add(string url, string metadata) { emplace(move(url), move(metadata)); }
+
+    // Constructs the node's strings in place from the given arguments
+    template<typename U, typename M>
+    void emplace(U&& url, M&& metadata) {
+        append(new Node(string(std::forward<U>(url)), string(std::forward<M>(metadata))));
+    }
     
     // Clears the entire list
     void clear();
@@ -198,32 +224,82 @@ public:
     
     // Returns current size of list
     size_t size() const { return size_; }
+
+private:
+    void append(Node* node);
+};
+
+// ----------------------------------------------------------------------------
+// LinkExtractor: streaming link extraction
+// ----------------------------------------------------------------------------
+// Consumes a page in arbitrary chunks (e.g. straight from recv buffers) and
+// emits links as soon as they are complete, so a page never has to be held
+// in memory as a whole. It finds the same patterns as extractUrls
+// (href=", href = ", http://, https://) on the same filtered, lowercase view
+// of the text, and matches spanning chunk boundaries are handled.
+class LinkExtractor {
+public:
+    LinkExtractor() { reset(); }
+
+    // Scans the next chunk of the page
+    void feed(const char* data, size_t length);
+
+    // Forgets partial matches and collected links, ready for a new page
+    void reset();
+
+    // Links found so far, as host and path records
+    UrlList& links() { return extracted; }
+
+    // Hosts of the links found with an https:// scheme
+    const UrlList& secureHosts() const { return secure; }
+
+    // Links longer than this are dropped, which bounds memory per page
+    static const size_t maxUrlLength = 2048;
+
+private:
+    static const int patternCount = 4;
+
+    struct PatternState {
+        size_t matched;              // Characters of the pattern matched so far
+        bool capturing;              // Pattern complete, collecting the URL
+        string url;                  // URL collected so far
+    };
+
+    PatternState states[patternCount];
+    bool idle;                       // No pattern partially matched or capturing
+    UrlList extracted;
+    UrlList secure;
+
+    void consume(char ch);
+    void emit(string_view url, bool https);
 };
 
 // ----------------------------------------------------------------------------
 // Function Declarations for URL Processing
 // ----------------------------------------------------------------------------
 
-// Extracts hostname from URL (e.g., "http://example.com/path" -> "example.com")
-string getHostnameFromUrl(const string& url);
+// Extracts hostname from URL (e.g., "http://example.com/path" -> "example.com").
+// The result is a view into url.
+string_view getHostnameFromUrl(string_view url);
 
-// Extracts path from URL (e.g., "http://example.com/path" -> "/path")
-string getHostPathFromUrl(const string& url);
+// Extracts path from URL (e.g., "http://example.com/path" -> "/path").
+// The result is a view into url (or a static "/").
+string_view getHostPathFromUrl(string_view url);
 
-// Extracts valid URLs from HTTP response text
-LinkedList extractUrls(const string& httpText);
+// Extracts valid URLs from HTTP response text in a single pass
+UrlList extractUrls(const string& httpText);
 
 // Validates URL based on domain and type
-bool verifyUrl(const string& url);
+bool verifyUrl(string_view url);
 
-// Verifies domain is in allowed list
-bool verifyDomain(const string& url);
+// Verifies the hostname ends with an allowed domain (see UrlFilter)
+bool verifyDomain(string_view url);
 
-// Verifies URL is not of a forbidden type
-bool verifyType(const string& url);
+// Verifies the URL or path does not name a file of a blocked type (see UrlFilter)
+bool verifyType(string_view url);
 
 // Checks if string ends with given suffix
-bool hasSuffix(const string& str, const string& suffix);
+bool hasSuffix(string_view str, string_view suffix);
 
 // Reformats HTTP response text for processing
 string reformatHttpResponse(const string& text);
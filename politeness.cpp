@@ -0,0 +1,177 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  Politeness Implementation
+ * ----------------------------------------------------------------------------
+ *  Token bucket with lazy refill: tokens are only recomputed when a request
+ *  slot is asked for, so an idle host costs nothing. Adaptive budgets scale
+ *  the refill rate down instead of dropping tokens, so a host recovering
+ *  from a back-off speeds up smoothly.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "politeness.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+
+// Back-off used when the concurrency cap, not the rate, is the limit
+const milliseconds busyRetry(20);
+
+const double minRateScale = 1.0 / 16;   // A struggling host keeps at least this share of its rate
+const double rateStep = 1.0 / 16;       // Rate share regained per response
+const int maxFailureStreak = 4;         // Timeout doubles at most this many times
+const int maxRetryAfter = 300;          // Seconds; longer Retry-After values are capped
+
+bool adaptiveHosts = false;
+int minTimeout = 1000;
+int maxTimeout = 10000;
+
+}
+
+void HostBudget::configure(bool adaptive, int minTimeoutMs, int maxTimeoutMs) {
+    adaptiveHosts = adaptive;
+    minTimeout = minTimeoutMs;
+    maxTimeout = maxTimeoutMs;
+}
+
+// An adaptive budget starts with one connection and grows to maxConcurrent
+// as the host keeps answering
+HostBudget::HostBudget(double rate, double burst, int maxConcurrent)
+    : rate(rate), burst(max(1.0, burst)), tokens(max(1.0, burst)),
+      maxConcurrent(max(1, maxConcurrent)), inFlight(0), lastRefill(steady_clock::now()),
+      adaptiveControl(adaptiveHosts), window(adaptiveHosts ? 1 : this->maxConcurrent), rateScale(1),
+      smoothedTime(-1), timeVariance(0), failureStreak(0), pausedUntil(lastRefill) {}
+
+void HostBudget::refill(TimePoint now) {
+    if (rate <= 0) return;
+    double elapsed = duration<double>(now - lastRefill).count();
+    tokens = min(burst, tokens + elapsed * rate * rateScale);
+    lastRefill = now;
+}
+
+int HostBudget::activeLimit() const {
+    return adaptiveControl ? max(1, (int)window) : maxConcurrent;
+}
+
+bool HostBudget::tryAcquire(TimePoint& retryAt) {
+    lock_guard<mutex> lock(budgetMutex);
+    TimePoint now = steady_clock::now();
+    refill(now);
+
+    if (now < pausedUntil) {
+        retryAt = pausedUntil;
+        return false;
+    }
+    if (inFlight >= activeLimit()) {
+        retryAt = now + busyRetry;
+        return false;
+    }
+    if (rate > 0 && tokens < 1.0) {
+        double wait = (1.0 - tokens) / (rate * rateScale);
+        retryAt = now + duration_cast<steady_clock::duration>(duration<double>(wait));
+        return false;
+    }
+
+    if (rate > 0) tokens -= 1.0;
+    inFlight++;
+    return true;
+}
+
+int HostBudget::takeExtra(int count) {
+    if (count <= 0) return 0;
+    lock_guard<mutex> lock(budgetMutex);
+    if (rate <= 0) return count;
+    refill(steady_clock::now());
+
+    int taken = min(count, (int)tokens);
+    tokens -= taken;
+    return taken;
+}
+
+void HostBudget::acquire() {
+    TimePoint retryAt;
+    while (!tryAcquire(retryAt)) {
+        this_thread::sleep_until(retryAt);
+    }
+}
+
+void HostBudget::release() {
+    lock_guard<mutex> lock(budgetMutex);
+    if (inFlight > 0) inFlight--;
+}
+
+void HostBudget::refund(int count) {
+    if (count <= 0) return;
+    lock_guard<mutex> lock(budgetMutex);
+    if (rate <= 0) return;
+    refill(steady_clock::now());
+    tokens = min(burst, tokens + count);
+}
+
+void HostBudget::limitRate(double limit) {
+    if (limit <= 0) return;
+    lock_guard<mutex> lock(budgetMutex);
+    if (rate > 0 && rate <= limit) return;
+    refill(steady_clock::now());
+    if (rate <= 0) lastRefill = steady_clock::now();
+    rate = limit;
+}
+
+// Additive increase: the window grows by about one connection per window's
+// worth of responses, and the rate regains a step per response
+void HostBudget::recordResponse(double responseTime) {
+    if (!adaptiveControl || responseTime < 0) return;
+    lock_guard<mutex> lock(budgetMutex);
+
+    if (smoothedTime < 0) {
+        smoothedTime = responseTime;
+        timeVariance = responseTime / 2;
+    } else {
+        timeVariance = 0.75 * timeVariance + 0.25 * fabs(smoothedTime - responseTime);
+        smoothedTime = 0.875 * smoothedTime + 0.125 * responseTime;
+    }
+    failureStreak = 0;
+
+    window = min((double)maxConcurrent, window + 1.0 / window);
+    if (rateScale < 1.0) {
+        refill(steady_clock::now());
+        rateScale = min(1.0, rateScale + rateStep);
+    }
+}
+
+// Multiplicative decrease
+void HostBudget::recordFailure(int retryAfter) {
+    if (!adaptiveControl) return;
+    lock_guard<mutex> lock(budgetMutex);
+    TimePoint now = steady_clock::now();
+
+    refill(now);
+    window = max(1.0, window / 2);
+    rateScale = max(minRateScale, rateScale / 2);
+    failureStreak = min(maxFailureStreak, failureStreak + 1);
+    if (retryAfter > 0) pausedUntil = max(pausedUntil, now + seconds(min(retryAfter, maxRetryAfter)));
+}
+
+int HostBudget::active() const {
+    lock_guard<mutex> lock(budgetMutex);
+    return inFlight;
+}
+
+int HostBudget::maxActive() const {
+    lock_guard<mutex> lock(budgetMutex);
+    return activeLimit();
+}
+
+// Twice the TCP retransmission estimate (SRTT + 4 * variance), doubled
+// again for every failure in a row
+int HostBudget::timeoutMs() const {
+    lock_guard<mutex> lock(budgetMutex);
+    if (!adaptiveControl || smoothedTime < 0) return maxTimeout;
+
+    double timeout = 2 * (smoothedTime + 4 * timeVariance) * (1 << failureStreak);
+    return (int)min<double>(maxTimeout, max<double>(minTimeout, timeout));
+}
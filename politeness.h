@@ -0,0 +1,97 @@
+/*
+* ----------------------------------------------------------------------------
+ *  Politeness Header - Per-Host Request Budgets
+ * ----------------------------------------------------------------------------
+ *  This header defines the HostBudget class that decides when the crawler
+ *  may send the next request to a host. It replaces the fixed sleep between
+ *  pages with two limits that several workers can share:
+ *  - A cap on concurrent requests (connections) to the host.
+ *  - A token bucket: `rate` requests per second with bursts of `burst`.
+ *
+ *  A host that allows more can be crawled by several workers at once while
+ *  the overall request rate still stays within the configured budget.
+ *
+ *  In adaptive mode the budget also follows how the host copes:
+ *  - Response times feed a smoothed estimate (SRTT and RTT variance, as
+ *    TCP does) that sets the host's I/O timeout.
+ *  - The concurrency cap and the rate are AIMD controlled: every response
+ *    adds to them, up to the configured limits, and every failure or
+ *    429/503 halves them. A Retry-After pauses the host altogether.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef POLITENESS_H
+#define POLITENESS_H
+
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+class HostBudget {
+public:
+    typedef chrono::steady_clock::time_point TimePoint;
+
+    // rate <= 0 disables the token bucket; maxConcurrent < 1 is treated as 1
+    HostBudget(double rate = 0, double burst = 1, int maxConcurrent = 1);
+
+    // Turns adaptive control on for budgets created afterwards. Timeouts
+    // stay within [minTimeoutMs, maxTimeoutMs]; maxTimeoutMs is also the
+    // timeout of every host when adaptive control is off.
+    static void configure(bool adaptive, int minTimeoutMs, int maxTimeoutMs);
+
+    // Reserves one request slot. On failure, retryAt is set to the earliest
+    // time a slot can become available (for a full concurrency cap, a short
+    // back-off since slots are freed by release()).
+    bool tryAcquire(TimePoint& retryAt);
+
+    // Takes up to count more tokens for requests pipelined behind a slot
+    // already reserved, without waiting. Returns how many were taken.
+    int takeExtra(int count);
+
+    // Waits until a slot is available and reserves it
+    void acquire();
+
+    // Returns a slot reserved by tryAcquire() or acquire()
+    void release();
+
+    // Puts back count tokens taken by tryAcquire() or takeExtra() for
+    // requests that were never sent (no page was left to request)
+    void refund(int count);
+
+    // Lowers the request rate to at most rate per second (a host's
+    // robots.txt Crawl-delay); a lower current rate is kept
+    void limitRate(double rate);
+
+    // Adaptive feedback: a response arrived after responseTime ms, or the
+    // host failed or throttled (retryAfter seconds, 0 when not given)
+    void recordResponse(double responseTime);
+    void recordFailure(int retryAfter = 0);
+
+    int active() const;
+    int maxActive() const;           // Current concurrency cap
+    int timeoutMs() const;           // I/O timeout for requests to the host
+    bool adaptive() const { return adaptiveControl; }
+
+private:
+    mutable mutex budgetMutex;
+    double rate;                     // Tokens added per second
+    double burst;                    // Bucket capacity
+    double tokens;                   // Tokens currently in the bucket
+    int maxConcurrent;               // Maximum requests in flight
+    int inFlight;                    // Requests currently in flight
+    TimePoint lastRefill;            // Last time tokens were added
+
+    bool adaptiveControl;            // Fields below are only used when set
+    double window;                   // AIMD concurrency cap, 1 up to maxConcurrent
+    double rateScale;                // AIMD share of rate in use
+    double smoothedTime;             // SRTT of responses in ms, -1 before the first
+    double timeVariance;             // RTT variance of responses in ms
+    int failureStreak;               // Failures since the last response; doubles the timeout
+    TimePoint pausedUntil;           // Retry-After of a throttling response
+
+    void refill(TimePoint now);
+    int activeLimit() const;
+};
+
+#endif
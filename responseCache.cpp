@@ -0,0 +1,136 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  ResponseCache Implementation
+ * ----------------------------------------------------------------------------
+ *  Entry layout (native byte order): "WRC1", u16 length + ETag, u16 length
+ *  + Last-Modified, u32 link count, then per link u16 length + host and
+ *  u16 length + path. Unreadable or truncated entries count as misses.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "responseCache.h"
+#include "urlSet.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const char magic[4] = {'W', 'R', 'C', '1'};
+
+void makeDirectory(const string& path) {
+#ifdef _WIN32
+    CreateDirectoryA(path.c_str(), nullptr);
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+void putText(string& out, string_view text) {
+    uint16_t length = (uint16_t)min<size_t>(text.size(), 0xFFFF);
+    out.append((const char*)&length, sizeof(length));
+    out.append(text.data(), length);
+}
+
+bool getText(const string& data, size_t& pos, string& out) {
+    uint16_t length;
+    if (data.size() - pos < sizeof(length)) return false;
+    memcpy(&length, data.data() + pos, sizeof(length));
+    pos += sizeof(length);
+    if (data.size() - pos < length) return false;
+    out.assign(data, pos, length);
+    pos += length;
+    return true;
+}
+
+}
+
+ResponseCache& ResponseCache::shared() {
+    static ResponseCache cache;
+    return cache;
+}
+
+void ResponseCache::configure(const string& directory) {
+    lock_guard<mutex> lock(configMutex);
+    root = directory;
+    makeDirectory(root);
+    active = true;
+}
+
+string ResponseCache::entryPath(string_view url, string& directory) {
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)urlFingerprint(url));
+
+    lock_guard<mutex> lock(configMutex);
+    directory = root + "/" + string(name, 2);
+    return directory + "/" + string(name + 2);
+}
+
+bool ResponseCache::lookup(string_view url, Entry& entry) {
+    if (!enabled()) return false;
+
+    string directory;
+    ifstream in(entryPath(url, directory), ios::binary);
+    if (!in) return false;
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    size_t pos = sizeof(magic);
+    uint32_t count;
+    if (data.size() < pos || memcmp(data.data(), magic, sizeof(magic)) != 0) return false;
+    if (!getText(data, pos, entry.etag) || !getText(data, pos, entry.lastModified)) return false;
+    if (data.size() - pos < sizeof(count)) return false;
+    memcpy(&count, data.data() + pos, sizeof(count));
+    pos += sizeof(count);
+
+    entry.links.clear();
+    string host, path;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!getText(data, pos, host) || !getText(data, pos, path)) return false;
+        entry.links.add(host, path);
+    }
+    return true;
+}
+
+void ResponseCache::store(string_view url, string_view etag, string_view lastModified, const UrlList& links) {
+    if (!enabled()) return;
+
+    string data(magic, sizeof(magic));
+    putText(data, etag);
+    putText(data, lastModified);
+    uint32_t count = (uint32_t)links.size();
+    data.append((const char*)&count, sizeof(count));
+    for (const UrlRecord& link : links) {
+        putText(data, links.host(link));
+        putText(data, links.path(link));
+    }
+
+    string directory;
+    string path = entryPath(url, directory);
+    makeDirectory(directory);
+
+    // Unique per thread, so concurrent stores of one URL cannot interleave
+    stringstream temporary;
+    temporary << path << ".tmp" << this_thread::get_id();
+    string temporaryPath = temporary.str();
+
+    FILE* out = fopen(temporaryPath.c_str(), "wb");
+    if (!out) return;
+    bool ok = fwrite(data.data(), data.size(), 1, out) == 1;
+    ok = fclose(out) == 0 && ok;
+    if (ok) {
+        remove(path.c_str());   // rename() does not replace an existing file on Windows
+        ok = rename(temporaryPath.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) remove(temporaryPath.c_str());
+    else storedCount++;
+}
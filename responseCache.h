@@ -0,0 +1,76 @@
+/*
+* ----------------------------------------------------------------------------
+ *  ResponseCache Header - Conditional GET Validators and Cached Link Sets
+ * ----------------------------------------------------------------------------
+ *  This header defines the ResponseCache class, a process-wide on-disk cache
+ *  of the pages the crawler has fetched before. For every page that came
+ *  with an ETag or Last-Modified header it keeps those validators and the
+ *  links extracted from the body. A re-crawl sends them back as
+ *  If-None-Match / If-Modified-Since, and when the server answers
+ *  304 Not Modified the cached links are used without downloading or
+ *  parsing the page again.
+ *
+ *  Key Features:
+ *  - Entries keyed by the 64-bit fingerprint of the canonical URL.
+ *  - One small binary file per page, in 256 sub-directories by the
+ *    fingerprint's first byte, so no directory grows too large.
+ *  - Entries are written to a temporary file and renamed into place, so a
+ *    reader never sees a half-written entry.
+ *  - Disabled (no disk access at all) until configure() is called.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <mutex>
+#include "urlArena.h"
+
+using namespace std;
+
+class ResponseCache {
+public:
+    struct Entry {
+        string etag;                 // ETag of the cached response, or ""
+        string lastModified;         // Last-Modified of the cached response, or ""
+        UrlList links;               // Links extracted from the cached body
+    };
+
+    // Returns the cache shared by all threads of the process
+    static ResponseCache& shared();
+
+    // Enables the cache, storing entries below directory
+    void configure(const string& directory);
+
+    bool enabled() const { return active.load(memory_order_relaxed); }
+
+    // Loads the entry for url; returns false when there is none
+    bool lookup(string_view url, Entry& entry);
+
+    // Saves validators and links for url, replacing any previous entry
+    void store(string_view url, string_view etag, string_view lastModified, const UrlList& links);
+
+    // Counts a 304 answered from the cache
+    void recordRevalidation() { revalidatedCount++; }
+
+    size_t revalidated() const { return revalidatedCount.load(); }
+    size_t stored() const { return storedCount.load(); }
+
+private:
+    ResponseCache() : active(false), revalidatedCount(0), storedCount(0) {}
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    atomic<bool> active;
+    mutex configMutex;
+    string root;                     // Cache directory
+    atomic<size_t> revalidatedCount;
+    atomic<size_t> storedCount;
+
+    string entryPath(string_view url, string& directory);
+};
+
+#endif
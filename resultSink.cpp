@@ -0,0 +1,348 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  ResultSink Implementation
+ * ----------------------------------------------------------------------------
+ *  Binary stream layout (native byte order): the magic "WRO1", then for each
+ *  site its visited pages followed by the site record, each starting with
+ *  one type byte:
+ *    'P' page: u16 length, url, f32 response time in ms
+ *    'W' site: u16 length, hostname, i32 depth, u32 pages, u32 failed,
+ *              u32 connections, u32 not modified, u32 redirected,
+ *              u32 not HTML, u32 too large, u32 pipelined, u32 disallowed
+ *              by robots.txt, u32 throttled, u64 bytes on wire, u64 bytes
+ *              decoded, f32 min / max / average response time in ms, u16
+ *              linked site count and per linked site u16 length,
+ *              hostname; then u8 phase count and per phase
+ *              (in Metric order) u32 samples, f32 p50 / p90 / p99 in ms
+ *  Strings longer than 65535 bytes are cut short.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "resultSink.h"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+
+// Keys of the page phases in JSON records, in Metric order
+const char* const phaseKeys[pageMetricCount] = {"dns", "connect", "handshake", "send", "ttfb", "download", "parse"};
+
+void putBytes(string& out, const void* data, size_t length) {
+    out.append(static_cast<const char*>(data), length);
+}
+
+void putText(string& out, string_view text) {
+    uint16_t length = (uint16_t)min<size_t>(text.size(), 0xFFFF);
+    putBytes(out, &length, sizeof(length));
+    out.append(text.data(), length);
+}
+
+void putU32(string& out, size_t value) {
+    uint32_t stored = (uint32_t)value;
+    putBytes(out, &stored, sizeof(stored));
+}
+
+void putF32(string& out, double value) {
+    float stored = (float)value;
+    putBytes(out, &stored, sizeof(stored));
+}
+
+void putNumber(string& out, double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.3f", value);
+    out += text;
+}
+
+void putJsonString(string& out, string_view text) {
+    out += '"';
+    for (char ch : text) {
+        switch (ch) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)ch < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)ch);
+                out += escaped;
+            } else {
+                out += ch;
+            }
+        }
+    }
+    out += '"';
+}
+
+void putJsonField(string& out, const char* key, size_t value) {
+    out += ",\"";
+    out += key;
+    out += "\":";
+    out += to_string(value);
+}
+
+void formatText(const SiteStats& stats, int depth, string& out) {
+    stringstream ss;
+    ss << fixed << setprecision(3);
+
+    // Basic site information
+    ss << "Website: " << stats.hostname << "\n"
+       << "Depth (distance from the starting pages): " << depth << "\n"
+       << "Number of Pages Discovered: " << stats.visitedPages.size() << "\n"
+       << "Number of Pages Failed to Discover: " << stats.numberOfPagesFailed << "\n"
+       << "Number of Linked Sites: " << (stats.linkedSites.empty() ? 0 : 1) << "\n"
+       << "Connections Opened: " << stats.connectionsOpened << "\n"
+       << "Pages Not Modified: " << stats.pagesNotModified << "\n"
+       << "Pages Redirected: " << stats.pagesRedirected << "\n"
+       << "Pages Skipped (Not HTML): " << stats.pagesNotHtml << "\n"
+       << "Pages Skipped (Too Large): " << stats.pagesTooLarge << "\n"
+       << "Pages Pipelined: " << stats.pagesPipelined << "\n"
+       << "Pages Disallowed (robots.txt): " << stats.pagesDisallowed << "\n"
+       << "Pages Throttled (429/503): " << stats.pagesThrottled << "\n"
+       << "Bytes On Wire: " << stats.bytesOnWire << "\n"
+       << "Bytes Decoded: " << stats.bytesDecoded << "\n"
+       << "Min. Response Time: " << stats.minResponseTime << "ms\n"
+       << "Max. Response Time: " << stats.maxResponseTime << "ms\n"
+       << "Average Response Time: " << stats.averageResponseTime << "ms\n";
+
+    ss << "Phase Latency (p50 / p90 / p99):\n";
+    stats.timings.print(ss, "  ");
+
+    // List of visited pages
+    if (!stats.visitedPages.empty()) {
+        ss << "List of visited pages:\n";
+        ss << "Response Time\tURL\n";
+        for (const auto& page : stats.visitedPages) {
+            ss << page.responseTime << "ms\t" << stats.visitedPages.url(page) << "\n";
+        }
+    }
+
+    out += ss.str();
+}
+
+void formatJson(const SiteStats& stats, int depth, string& out) {
+    for (const auto& page : stats.visitedPages) {
+        out += "{\"type\":\"page\",\"site\":";
+        putJsonString(out, stats.hostname);
+        out += ",\"url\":";
+        putJsonString(out, stats.visitedPages.url(page));
+        out += ",\"responseTime\":";
+        putNumber(out, page.responseTime);
+        out += "}\n";
+    }
+
+    out += "{\"type\":\"site\",\"site\":";
+    putJsonString(out, stats.hostname);
+    out += ",\"depth\":" + to_string(depth);
+    putJsonField(out, "pages", stats.visitedPages.size());
+    putJsonField(out, "failed", stats.numberOfPagesFailed);
+    putJsonField(out, "connections", stats.connectionsOpened);
+    putJsonField(out, "notModified", stats.pagesNotModified);
+    putJsonField(out, "redirected", stats.pagesRedirected);
+    putJsonField(out, "notHtml", stats.pagesNotHtml);
+    putJsonField(out, "tooLarge", stats.pagesTooLarge);
+    putJsonField(out, "pipelined", stats.pagesPipelined);
+    putJsonField(out, "disallowed", stats.pagesDisallowed);
+    putJsonField(out, "throttled", stats.pagesThrottled);
+    putJsonField(out, "bytesOnWire", stats.bytesOnWire);
+    putJsonField(out, "bytesDecoded", stats.bytesDecoded);
+
+    out += ",\"responseTime\":{\"min\":";
+    putNumber(out, stats.minResponseTime);
+    out += ",\"max\":";
+    putNumber(out, stats.maxResponseTime);
+    out += ",\"avg\":";
+    putNumber(out, stats.averageResponseTime);
+    out += "}";
+
+    out += ",\"linkedSites\":[";
+    bool first = true;
+    for (const auto& site : stats.linkedSites) {
+        if (!first) out += ',';
+        putJsonString(out, stats.linkedSites.host(site));
+        first = false;
+    }
+    out += "]";
+
+    // Percentiles in ms, for the phases with samples
+    out += ",\"phases\":{";
+    first = true;
+    for (int i = 0; i < pageMetricCount; i++) {
+        const LatencyHistogram& phase = stats.timings.phases[i];
+        if (phase.count() == 0) continue;
+        if (!first) out += ',';
+        out += "\"";
+        out += phaseKeys[i];
+        out += "\":{\"count\":" + to_string(phase.count()) + ",\"p50\":";
+        putNumber(out, phase.percentile(50) / 1000);
+        out += ",\"p90\":";
+        putNumber(out, phase.percentile(90) / 1000);
+        out += ",\"p99\":";
+        putNumber(out, phase.percentile(99) / 1000);
+        out += "}";
+        first = false;
+    }
+    out += "}}\n";
+}
+
+void formatBinary(const SiteStats& stats, int depth, string& out) {
+    for (const auto& page : stats.visitedPages) {
+        out += 'P';
+        putText(out, stats.visitedPages.url(page));
+        putF32(out, page.responseTime);
+    }
+
+    out += 'W';
+    putText(out, stats.hostname);
+    int32_t storedDepth = depth;
+    putBytes(out, &storedDepth, sizeof(storedDepth));
+    putU32(out, stats.visitedPages.size());
+    putU32(out, stats.numberOfPagesFailed);
+    putU32(out, stats.connectionsOpened);
+    putU32(out, stats.pagesNotModified);
+    putU32(out, stats.pagesRedirected);
+    putU32(out, stats.pagesNotHtml);
+    putU32(out, stats.pagesTooLarge);
+    putU32(out, stats.pagesPipelined);
+    putU32(out, stats.pagesDisallowed);
+    putU32(out, stats.pagesThrottled);
+    uint64_t bytes[2] = {stats.bytesOnWire, stats.bytesDecoded};
+    putBytes(out, bytes, sizeof(bytes));
+    putF32(out, stats.minResponseTime);
+    putF32(out, stats.maxResponseTime);
+    putF32(out, stats.averageResponseTime);
+
+    uint16_t linkedCount = (uint16_t)min<size_t>(stats.linkedSites.size(), 0xFFFF);
+    putBytes(out, &linkedCount, sizeof(linkedCount));
+    for (const auto& site : stats.linkedSites) {
+        if (linkedCount-- == 0) break;
+        putText(out, stats.linkedSites.host(site));
+    }
+
+    out += (char)pageMetricCount;
+    for (int i = 0; i < pageMetricCount; i++) {
+        const LatencyHistogram& phase = stats.timings.phases[i];
+        putU32(out, phase.count());
+        putF32(out, phase.percentile(50) / 1000);
+        putF32(out, phase.percentile(90) / 1000);
+        putF32(out, phase.percentile(99) / 1000);
+    }
+}
+
+}
+
+ResultSink& ResultSink::shared() {
+    static ResultSink sink;
+    return sink;
+}
+
+ResultSink::ResultSink()
+    : format(Format::Text), file(stdout), ownsFile(false), reports(queueCapacity), sleeping(false), stopping(false) {}
+
+ResultSink::Format ResultSink::parseFormat(const string& name) {
+    if (name == "text") return Format::Text;
+    if (name == "jsonl") return Format::JsonLines;
+    if (name == "binary") return Format::Binary;
+    throw runtime_error("outputFormat must be text, jsonl or binary");
+}
+
+void ResultSink::start(Format outputFormat, const string& path) {
+    stop();
+    format = outputFormat;
+    if (!path.empty()) {
+        file = fopen(path.c_str(), format == Format::Binary ? "wb" : "w");
+        if (!file) throw runtime_error("Cannot create output file " + path);
+        ownsFile = true;
+    }
+    if (format == Format::Binary) fwrite("WRO1", 4, 1, file);
+
+    stopping = false;
+    writer = thread(&ResultSink::writeLoop, this);
+}
+
+void ResultSink::stop() {
+    if (writer.joinable()) {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wakeSignal.notify_all();
+        writer.join();
+    }
+
+    if (ownsFile) {
+        fclose(file);
+        file = stdout;
+        ownsFile = false;
+    }
+    fflush(file);
+}
+
+void ResultSink::submit(SiteStats&& stats, int depth) {
+    unique_ptr<SiteReport> report(new SiteReport{move(stats), depth});
+
+    if (!writer.joinable()) {
+        string out;
+        formatReport(*report, out);
+        lock_guard<mutex> lock(directMutex);
+        write(out);
+        fflush(file);
+        return;
+    }
+
+    // A full queue means the writer is behind; wait for it rather than
+    // buffer without bound
+    while (!reports.push(move(report))) this_thread::yield();
+
+    // Pairs with the fence in writeLoop(): either the writer sees the
+    // report, or we see it sleeping and wake it
+    atomic_thread_fence(memory_order_seq_cst);
+    if (sleeping.load()) {
+        lock_guard<mutex> lock(wakeMutex);
+        wakeSignal.notify_one();
+    }
+}
+
+void ResultSink::formatReport(const SiteReport& report, string& out) const {
+    switch (format) {
+    case Format::Text: formatText(report.stats, report.depth, out); break;
+    case Format::JsonLines: formatJson(report.stats, report.depth, out); break;
+    case Format::Binary: formatBinary(report.stats, report.depth, out); break;
+    }
+}
+
+void ResultSink::write(string& out) {
+    if (out.empty()) return;
+    fwrite(out.data(), out.size(), 1, file);
+    out.clear();
+}
+
+// Formats reports into one buffer, written when it is large or the queue
+// runs dry, so a burst of small sites costs a single write
+void ResultSink::writeLoop() {
+    string out;
+    unique_ptr<SiteReport> report;
+
+    while (true) {
+        if (reports.pop(report)) {
+            formatReport(*report, out);
+            report.reset();
+            if (out.size() >= writeBytes) write(out);
+            continue;
+        }
+
+        write(out);
+        fflush(file);
+
+        unique_lock<mutex> lock(wakeMutex);
+        if (stopping && reports.empty()) break;
+        sleeping = true;
+        atomic_thread_fence(memory_order_seq_cst);
+        if (reports.empty() && !stopping) wakeSignal.wait_for(lock, chrono::milliseconds(100));
+        sleeping = false;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+* ----------------------------------------------------------------------------
+ *  ResultSink Header - Asynchronous Crawl Result Output
+ * ----------------------------------------------------------------------------
+ *  This header defines the ResultSink class, the output stage of the
+ *  crawler. Finished sites are handed to it through a lock-free queue; a
+ *  dedicated writer thread formats their reports and writes them out in
+ *  large buffered writes, so crawling threads never format output or wait
+ *  on the console or a file while holding crawler locks.
+ *
+ *  Key Features:
+ *  - Three formats: the human-readable site summaries, JSON Lines (one
+ *    object per visited page, then one per site) and a compact binary
+ *    record stream for downstream tools.
+ *  - Handoff through the bounded MPMC Queue; producers only wait when the
+ *    writer is a full queue behind.
+ *  - Output goes to stdout or to a file, flushed whenever the writer
+ *    catches up and once more at exit.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include <string>
+#include <cstdio>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "clientSocket.h"
+#include "parser.h"
+
+using namespace std;
+
+class ResultSink {
+public:
+    enum class Format {
+        Text,       // Site summaries as printed on the console
+        JsonLines,  // {"type":"page",...} per visited page, then {"type":"site",...}
+        Binary      // Length-prefixed records, see resultSink.cpp
+    };
+
+    static ResultSink& shared();
+
+    // Parses "text", "jsonl" or "binary"; throws runtime_error otherwise
+    static Format parseFormat(const string& name);
+
+    // Starts the writer thread. An empty path writes to stdout. Throws
+    // runtime_error when the file cannot be created.
+    void start(Format format, const string& path);
+
+    // Queues the report of a finished site. Thread-safe; the writer owns
+    // stats from here on. Without start() the report is written right away.
+    void submit(SiteStats&& stats, int depth);
+
+    // Writes out every queued report, then stops the writer thread
+    void stop();
+
+    ResultSink(const ResultSink&) = delete;
+    ResultSink& operator=(const ResultSink&) = delete;
+
+private:
+    struct SiteReport {
+        SiteStats stats;
+        int depth;
+    };
+
+    static const size_t queueCapacity = 1024;     // Reports in flight to the writer
+    static const size_t writeBytes = 1 << 20;     // Formatted output buffered before a write
+
+    Format format;
+    FILE* file;
+    bool ownsFile;                   // file was opened by start(), not stdout
+    Queue<unique_ptr<SiteReport>> reports;
+    thread writer;
+    mutex wakeMutex;                 // Guards stopping; the writer sleeps on wakeSignal
+    condition_variable wakeSignal;
+    atomic<bool> sleeping;           // The writer is (about to be) waiting for reports
+    bool stopping;
+    mutex directMutex;               // Serializes writes when no writer thread runs
+
+    ResultSink();
+    ~ResultSink() { stop(); }
+
+    void formatReport(const SiteReport& report, string& out) const;
+    void write(string& out);
+    void writeLoop();
+};
+
+#endif
@@ -0,0 +1,211 @@
+/*
+* ----------------------------------------------------------------------------
+ *  Robots Implementation
+ * ----------------------------------------------------------------------------
+ *  robots.txt is read line by line: consecutive User-agent lines open a
+ *  group, and the rules that follow belong to every agent of that group.
+ *  Groups naming the crawler are merged, and only if there is none are the
+ *  "*" groups used. Each pattern is split on '*' into literal pieces; the
+ *  first piece must start the path, the others are found left to right,
+ *  which is exact for patterns that only have wildcards between literals.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "robots.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+const double maxCrawlDelay = 60;     // Seconds; longer delays would stall a site for good
+const size_t maxCachedHosts = 1 << 20;
+
+char lower(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? (char)(ch - 'A' + 'a') : ch;
+}
+
+string_view trim(string_view text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == string_view::npos) return string_view();
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+// "WebReaper/1.0 (+http://...)" -> "webreaper"
+string productToken(string_view agent) {
+    string token;
+    for (char ch : trim(agent)) {
+        if (ch == '/' || ch == ' ' || ch == '\t') break;
+        token += lower(ch);
+    }
+    return token;
+}
+
+bool equalsIgnoreCase(string_view a, string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (lower(a[i]) != lower(b[i])) return false;
+    }
+    return true;
+}
+
+}
+
+// ----------------------------------------------------------------------------
+// RobotsRules
+// ----------------------------------------------------------------------------
+const char* const RobotsRules::path = "/robots.txt";
+
+bool RobotsRules::Rule::matches(string_view text) const {
+    const string& first = pieces.front();
+    if (text.compare(0, first.size(), first) != 0) return false;
+    size_t pos = first.size();
+    if (pieces.size() == 1) return !anchored || pos == text.size();
+
+    for (size_t i = 1; i + 1 < pieces.size(); i++) {
+        size_t found = text.find(pieces[i], pos);
+        if (found == string_view::npos) return false;
+        pos = found + pieces[i].size();
+    }
+
+    const string& last = pieces.back();
+    if (!anchored) return text.find(last, pos) != string_view::npos;
+    return text.size() >= pos + last.size() && text.compare(text.size() - last.size(), last.size(), last) == 0;
+}
+
+void RobotsRules::addRule(string_view pattern, bool allow) {
+    Rule rule;
+    rule.length = pattern.size();
+    rule.allow = allow;
+    rule.anchored = !pattern.empty() && pattern.back() == '$';
+    if (rule.anchored) pattern.remove_suffix(1);
+
+    size_t start = 0;
+    while (true) {
+        size_t star = pattern.find('*', start);
+        rule.pieces.emplace_back(pattern.substr(start, star - start));
+        if (star == string_view::npos) break;
+        start = star + 1;
+    }
+    rules.push_back(move(rule));
+}
+
+// The first rule that matches is then the longest one, with Allow winning
+// between patterns of the same length
+void RobotsRules::compile() {
+    stable_sort(rules.begin(), rules.end(), [](const Rule& a, const Rule& b) {
+        if (a.length != b.length) return a.length > b.length;
+        return a.allow && !b.allow;
+    });
+}
+
+shared_ptr<const RobotsRules> RobotsRules::parse(string_view text, string_view agent) {
+    string token = productToken(agent);
+    shared_ptr<RobotsRules> ours(new RobotsRules());
+    shared_ptr<RobotsRules> anyone(new RobotsRules());
+    bool namedUs = false;            // Some group names the crawler
+
+    bool inAgents = false;           // Still reading the User-agent lines of a group
+    bool forUs = false, forAnyone = false;
+
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        string_view line = text.substr(0, end);
+        text = end == string_view::npos ? string_view() : text.substr(end + 1);
+
+        line = line.substr(0, line.find('#'));
+        size_t colon = line.find(':');
+        if (colon == string_view::npos) continue;
+        string_view key = trim(line.substr(0, colon));
+        string_view value = trim(line.substr(colon + 1));
+        if (!value.empty() && value.back() == '\r') value = trim(value.substr(0, value.size() - 1));
+
+        if (equalsIgnoreCase(key, "user-agent")) {
+            if (!inAgents) forUs = forAnyone = false;
+            inAgents = true;
+            if (value == "*") {
+                forAnyone = true;
+            } else if (!token.empty() && productToken(value) == token) {
+                forUs = true;
+                namedUs = true;
+            }
+            continue;
+        }
+
+        bool allow = equalsIgnoreCase(key, "allow");
+        bool disallow = equalsIgnoreCase(key, "disallow");
+        bool delay = equalsIgnoreCase(key, "crawl-delay");
+        if (!allow && !disallow && !delay) continue;   // Sitemap and unknown records
+        inAgents = false;
+
+        for (RobotsRules* rules : {forUs ? ours.get() : nullptr, forAnyone ? anyone.get() : nullptr}) {
+            if (!rules) continue;
+            if (delay) {
+                double seconds = strtod(string(value).c_str(), nullptr);
+                if (seconds > 0) rules->delay = min(maxCrawlDelay, seconds);
+            } else if (!value.empty()) {
+                rules->addRule(value, allow);   // An empty Disallow allows everything
+            }
+        }
+    }
+
+    shared_ptr<RobotsRules>& chosen = namedUs ? ours : anyone;
+    chosen->compile();
+    return chosen;
+}
+
+shared_ptr<const RobotsRules> RobotsRules::allowAll() {
+    static shared_ptr<const RobotsRules> rules(new RobotsRules());
+    return rules;
+}
+
+shared_ptr<const RobotsRules> RobotsRules::disallowAll() {
+    static shared_ptr<const RobotsRules> rules = [] {
+        shared_ptr<RobotsRules> everything(new RobotsRules());
+        everything->addRule("/", false);
+        return everything;
+    }();
+    return rules;
+}
+
+bool RobotsRules::allows(string_view target) const {
+    if (target == path) return true;
+    for (const Rule& rule : rules) {
+        if (rule.matches(target)) return rule.allow;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// RobotsCache
+// ----------------------------------------------------------------------------
+RobotsCache& RobotsCache::shared() {
+    static RobotsCache cache;
+    return cache;
+}
+
+RobotsCache::RobotsCache() : on(false) {}
+
+void RobotsCache::configure(const string& userAgent) {
+    agent = userAgent;
+    on = true;
+}
+
+shared_ptr<const RobotsRules> RobotsCache::lookup(const string& hostname) const {
+    lock_guard<mutex> lock(cacheMutex);
+    auto it = rulesByHost.find(hostname);
+    return it == rulesByHost.end() ? nullptr : it->second;
+}
+
+// Sites are mostly crawled once, so the cache only has to stay bounded,
+// not keep the hottest hosts
+void RobotsCache::store(const string& hostname, shared_ptr<const RobotsRules> rules) {
+    lock_guard<mutex> lock(cacheMutex);
+    if (rulesByHost.size() >= maxCachedHosts && !rulesByHost.count(hostname)) rulesByHost.erase(rulesByHost.begin());
+    rulesByHost[hostname] = move(rules);
+}
+
+size_t RobotsCache::hosts() const {
+    lock_guard<mutex> lock(cacheMutex);
+    return rulesByHost.size();
+}
@@ -0,0 +1,101 @@
+/*
+* ----------------------------------------------------------------------------
+ *  Robots Header - robots.txt Rules and the Shared Rule Cache
+ * ----------------------------------------------------------------------------
+ *  This header defines RobotsRules, the Allow/Disallow rules and
+ *  Crawl-delay that a host's /robots.txt sets for the crawler, and
+ *  RobotsCache, the process-wide cache of those rules by hostname. Every
+ *  site fetches its robots.txt before its first page (see ClientSocket),
+ *  so pages the host disallows are never requested.
+ *
+ *  Key Features:
+ *  - Follows RFC 9309: the group naming the crawler's product token wins
+ *    over the "*" group, the longest matching pattern decides, and Allow
+ *    wins a tie.
+ *  - Patterns support the "*" wildcard and the "$" end anchor; they are
+ *    compiled once into literal pieces, ordered longest first, so a check
+ *    stops at the first pattern that matches.
+ *  - Crawl-delay is kept to slow down the host's HostBudget (it never
+ *    speeds a host up beyond the configured crawl delay).
+ *  - Compiled rules are shared (immutable) and cached for the whole crawl.
+ *  - Disabled until configure() is called.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef ROBOTS_H
+#define ROBOTS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+class RobotsRules {
+public:
+    static const char* const path;   // "/robots.txt"
+
+    // Compiles the rules of the group that applies to agent (a User-Agent
+    // string; its product token before any '/' or space is matched)
+    static shared_ptr<const RobotsRules> parse(string_view text, string_view agent);
+
+    // A missing robots.txt (4xx) allows everything; an unreachable one
+    // (5xx, connection failure) disallows everything
+    static shared_ptr<const RobotsRules> allowAll();
+    static shared_ptr<const RobotsRules> disallowAll();
+
+    // path is the request path, query included
+    bool allows(string_view path) const;
+
+    double crawlDelay() const { return delay; }   // Seconds, 0 when none was given
+    size_t size() const { return rules.size(); }
+
+private:
+    struct Rule {
+        vector<string> pieces;       // Literal text between the '*' wildcards
+        size_t length;               // Length of the pattern as written
+        bool allow;                  // Allow or Disallow
+        bool anchored;               // Ends with '$': must match up to the end of the path
+
+        bool matches(string_view path) const;
+    };
+
+    vector<Rule> rules;              // Longest pattern first, Allow before Disallow
+    double delay = 0;
+
+    void addRule(string_view pattern, bool allow);
+    void compile();
+};
+
+class RobotsCache {
+public:
+    static RobotsCache& shared();
+
+    // Turns robots.txt handling on for agent (the crawler's User-Agent)
+    void configure(const string& agent);
+
+    bool enabled() const { return on; }
+    const string& userAgent() const { return agent; }
+
+    // Rules stored for hostname, or null when it was not fetched yet
+    shared_ptr<const RobotsRules> lookup(const string& hostname) const;
+    void store(const string& hostname, shared_ptr<const RobotsRules> rules);
+
+    size_t hosts() const;
+
+    RobotsCache(const RobotsCache&) = delete;
+    RobotsCache& operator=(const RobotsCache&) = delete;
+
+private:
+    mutable mutex cacheMutex;
+    unordered_map<string, shared_ptr<const RobotsRules>> rulesByHost;
+    bool on;                         // configure() was called
+    string agent;
+
+    RobotsCache();
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  SpillQueue Implementation
+ * ----------------------------------------------------------------------------
+ *  Segment record layout: uint32 length, int32 depth, then length bytes of
+ *  text, in native byte order (segments never leave the machine). While any
+ *  entry is on disk new entries go to disk too, so FIFO order holds; once
+ *  the disk tier has drained, pushes return to memory.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "spillQueue.h"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+mutex configMutex;
+string spillDirectory = "spill";
+size_t spillSegmentBytes = 4 * 1024 * 1024;
+atomic<int> nextQueueId(0);
+
+const size_t recordHeader = 2 * sizeof(uint32_t);
+
+void makeDirectory(const string& path) {
+#ifdef _WIN32
+    CreateDirectoryA(path.c_str(), nullptr);
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+void removeFile(const string& path) {
+#ifdef _WIN32
+    DeleteFileA(path.c_str());
+#else
+    unlink(path.c_str());
+#endif
+}
+
+}
+
+void SpillQueue::configure(const string& directory, size_t segmentBytes) {
+    lock_guard<mutex> lock(configMutex);
+    spillDirectory = directory;
+    spillSegmentBytes = segmentBytes;
+}
+
+SpillQueue::SpillQueue(size_t memoryBudget)
+    : budget(memoryBudget), diskCount(0), spillCount(0), id(nextQueueId++), segmentSequence(0),
+      writer(nullptr), writerBytes(0) {}
+
+SpillQueue::~SpillQueue() {
+    clear();
+}
+
+bool SpillQueue::spillToDisk() const {
+    return diskCount > 0 || (budget > 0 && memory.memoryBytes() >= budget);
+}
+
+void SpillQueue::push(string_view text, int depth) {
+    if (spillToDisk()) writeRecord(text, depth);
+    else memory.add("", text, depth);
+}
+
+bool SpillQueue::pop(string& text, int& depth) {
+    if (!memory.empty()) {
+        const UrlRecord& record = memory.front();
+        text.assign(memory.path(record));
+        depth = record.depth;
+        memory.pop();
+        return true;
+    }
+
+    if (diskCount == 0) return false;
+    if (reader.offset >= reader.length && !openNextSegment()) return false;
+
+    uint32_t length;
+    int32_t storedDepth;
+    memcpy(&length, reader.data + reader.offset, sizeof(length));
+    memcpy(&storedDepth, reader.data + reader.offset + sizeof(length), sizeof(storedDepth));
+    text.assign(reader.data + reader.offset + recordHeader, length);
+    depth = storedDepth;
+    reader.offset += recordHeader + length;
+    diskCount--;
+
+    if (reader.offset >= reader.length) closeReader();
+    return true;
+}
+
+void SpillQueue::clear() {
+    memory.clear();
+    closeReader();
+    if (writer) {
+        fclose(writer);
+        writer = nullptr;
+        removeFile(writerPath);
+    }
+    for (const string& path : sealedSegments) removeFile(path);
+    sealedSegments.clear();
+    diskCount = 0;
+}
+
+void SpillQueue::writeRecord(string_view text, int depth) {
+    if (!writer) {
+        string directory;
+        {
+            lock_guard<mutex> lock(configMutex);
+            directory = spillDirectory;
+        }
+        makeDirectory(directory);
+        writerPath = directory + "/q" + to_string(id) + "-" + to_string(segmentSequence++) + ".seg";
+        writer = fopen(writerPath.c_str(), "wb");
+        if (!writer) throw runtime_error("Cannot create frontier segment " + writerPath);
+        writerBytes = 0;
+    }
+
+    uint32_t length = (uint32_t)text.size();
+    int32_t storedDepth = depth;
+    bool ok = fwrite(&length, sizeof(length), 1, writer) == 1 &&
+              fwrite(&storedDepth, sizeof(storedDepth), 1, writer) == 1 &&
+              (length == 0 || fwrite(text.data(), length, 1, writer) == 1);
+    if (!ok) throw runtime_error("Cannot write frontier segment " + writerPath);
+
+    writerBytes += recordHeader + length;
+    diskCount++;
+    spillCount++;
+
+    size_t segmentLimit;
+    {
+        lock_guard<mutex> lock(configMutex);
+        segmentLimit = spillSegmentBytes;
+    }
+    if (writerBytes >= segmentLimit) sealWriter();
+}
+
+void SpillQueue::sealWriter() {
+    if (!writer) return;
+    fclose(writer);
+    writer = nullptr;
+    sealedSegments.push_back(writerPath);
+}
+
+// Maps the oldest segment; the one still being written is sealed first
+bool SpillQueue::openNextSegment() {
+    closeReader();
+    if (sealedSegments.empty()) sealWriter();
+    if (sealedSegments.empty()) return false;
+
+    reader.path = sealedSegments.front();
+    sealedSegments.pop_front();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(reader.path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw runtime_error("Cannot open frontier segment " + reader.path);
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    reader.length = (size_t)size.QuadPart;
+    HANDLE mapping = reader.length ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle(file);
+    if (reader.length && !mapping) throw runtime_error("Cannot map frontier segment " + reader.path);
+    reader.mapping = mapping;
+    reader.data = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+    int fd = open(reader.path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("Cannot open frontier segment " + reader.path);
+    struct stat info;
+    fstat(fd, &info);
+    reader.length = (size_t)info.st_size;
+    void* data = reader.length ? mmap(nullptr, reader.length, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if (data == MAP_FAILED) throw runtime_error("Cannot map frontier segment " + reader.path);
+    if (data) madvise(data, reader.length, MADV_SEQUENTIAL);
+    reader.data = (const char*)data;
+#endif
+
+    reader.offset = 0;
+    if (reader.length == 0) {
+        closeReader();
+        return openNextSegment();
+    }
+    return true;
+}
+
+void SpillQueue::closeReader() {
+    if (reader.path.empty()) return;
+
+#ifdef _WIN32
+    if (reader.data) UnmapViewOfFile(reader.data);
+    if (reader.mapping) CloseHandle((HANDLE)reader.mapping);
+#else
+    if (reader.data) munmap((void*)reader.data, reader.length);
+#endif
+
+    removeFile(reader.path);
+    reader = MappedSegment();
+}
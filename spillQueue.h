@@ -0,0 +1,88 @@
+/*
+* ----------------------------------------------------------------------------
+ *  SpillQueue Header - Disk-Spilling FIFO for Frontiers Bigger Than RAM
+ * ----------------------------------------------------------------------------
+ *  This header defines the SpillQueue class, a FIFO of (URL, depth) entries
+ *  whose memory use is capped by a budget. Entries are kept in memory until
+ *  the budget is reached; from then on they are appended to segment files
+ *  on disk, which are memory-mapped and read back in order once everything
+ *  before them has been dequeued.
+ *
+ *  Key Features:
+ *  - Hot in-memory segment (an arena-backed UrlList) bounded by a budget.
+ *  - Append-only segment files of a few MB, written through stdio buffers.
+ *  - Sealed segments are memory-mapped for dequeue and deleted once read,
+ *    so disk usage also shrinks as the crawl progresses.
+ *  - Strict FIFO order across the memory and disk tiers.
+ *  - Not thread-safe; callers guard it with their own lock.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef SPILLQUEUE_H
+#define SPILLQUEUE_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include "urlArena.h"
+
+using namespace std;
+
+class SpillQueue {
+public:
+    // memoryBudget is in bytes; 0 keeps everything in memory
+    explicit SpillQueue(size_t memoryBudget = 0);
+    ~SpillQueue();
+
+    // Sets the directory that receives segment files (default "spill") and
+    // the size at which a segment is sealed. Call before the crawl starts.
+    static void configure(const string& directory, size_t segmentBytes);
+
+    void push(string_view text, int depth = 0);
+
+    // Removes the oldest entry; returns false when the queue is empty
+    bool pop(string& text, int& depth);
+
+    void clear();
+
+    bool empty() const { return size() == 0; }
+    size_t size() const { return memory.size() + diskCount; }
+    size_t spilled() const { return spillCount; }   // Entries ever written to disk
+
+private:
+    // A sealed segment mapped into memory for reading
+    struct MappedSegment {
+        string path;
+        const char* data = nullptr;
+        size_t length = 0;
+        size_t offset = 0;            // Read position
+        void* mapping = nullptr;      // Platform handle of the mapping
+    };
+
+    size_t budget;
+    UrlList memory;                   // Hot tier, always older than anything on disk
+    size_t diskCount;                 // Entries in segment files not yet read
+    size_t spillCount;
+
+    int id;                           // Distinguishes the segment files of this queue
+    unsigned segmentSequence;
+    deque<string> sealedSegments;     // Complete segment files, oldest first
+    FILE* writer;                     // Segment being appended to, or nullptr
+    string writerPath;
+    size_t writerBytes;
+    MappedSegment reader;             // Segment being read, when mapped
+
+    bool spillToDisk() const;
+    void writeRecord(string_view text, int depth);
+    void sealWriter();
+    bool openNextSegment();
+    void closeReader();
+
+    SpillQueue(const SpillQueue&) = delete;
+    SpillQueue& operator=(const SpillQueue&) = delete;
+};
+
+#endif
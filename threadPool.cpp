@@ -0,0 +1,187 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  ThreadPool Implementation
+ * ----------------------------------------------------------------------------
+ *  Workers only touch idleMutex when they run out of work entirely; the hot
+ *  path is a push/pop on a per-worker deque guarded by that deque's mutex.
+ *  Delayed tasks sit in a binary heap; each worker moves the due ones onto
+ *  its own deque before looking for work, and idle workers sleep only until
+ *  the earliest due time.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "threadPool.h"
+#include <algorithm>
+
+namespace {
+
+thread_local int workerIndex = -1;
+
+}
+
+ThreadPool::ThreadPool(int workerCount)
+    : queuedCount(0), unfinishedCount(0), stealCount(0), nextQueue(0), stopping(false), timerSequence(0), timerGeneration(0) {
+    if (workerCount < 1) workerCount = 1;
+
+    for (int i = 0; i < workerCount; i++) {
+        queues.push_back(unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for (int i = 0; i < workerCount; i++) {
+        workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(idleMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::currentWorker() {
+    return workerIndex;
+}
+
+void ThreadPool::submit(Task task) {
+    int owner = workerIndex;
+    if (owner < 0 || owner >= (int)queues.size()) {
+        owner = (int)(nextQueue++ % queues.size());
+    }
+
+    unfinishedCount++;
+    queuedCount++;
+    {
+        lock_guard<mutex> lock(queues[owner]->queueMutex);
+        queues[owner]->tasks.push_back(move(task));
+    }
+
+    // Taking the lock orders this notify after a sleeper's predicate check
+    { lock_guard<mutex> lock(idleMutex); }
+    workAvailable.notify_one();
+}
+
+void ThreadPool::submitAt(TimePoint due, Task task) {
+    if (due <= chrono::steady_clock::now()) {
+        submit(move(task));
+        return;
+    }
+
+    unfinishedCount++;
+    {
+        lock_guard<mutex> lock(timerMutex);
+        timers.push_back(TimedTask{due, timerSequence++, move(task)});
+        push_heap(timers.begin(), timers.end(), greater<TimedTask>());
+    }
+
+    // Sleepers may be waiting for a later timer than this one; the new
+    // generation ends their wait so they recompute the earliest due time
+    {
+        lock_guard<mutex> lock(idleMutex);
+        timerGeneration++;
+    }
+    workAvailable.notify_one();
+}
+
+// Moves every timer that is due onto the worker's own deque
+void ThreadPool::releaseDueTimers(int index) {
+    TimePoint now = chrono::steady_clock::now();
+    size_t released = 0;
+    {
+        lock_guard<mutex> lock(timerMutex);
+
+        while (!timers.empty() && timers.front().due <= now) {
+            pop_heap(timers.begin(), timers.end(), greater<TimedTask>());
+            Task task = move(timers.back().task);
+            timers.pop_back();
+
+            queuedCount++;
+            released++;
+            lock_guard<mutex> queueLock(queues[index]->queueMutex);
+            queues[index]->tasks.push_back(move(task));
+        }
+    }
+
+    // Let sleeping workers steal whatever this worker cannot run right away
+    if (released > 1) {
+        { lock_guard<mutex> lock(idleMutex); }
+        workAvailable.notify_all();
+    }
+}
+
+bool ThreadPool::nextTimer(TimePoint& due) {
+    lock_guard<mutex> lock(timerMutex);
+    if (timers.empty()) return false;
+    due = timers.front().due;
+    return true;
+}
+
+void ThreadPool::waitIdle() {
+    unique_lock<mutex> lock(idleMutex);
+    allDone.wait(lock, [this] { return unfinishedCount.load() == 0; });
+}
+
+// Own deque from the back first, then steal from the front of the others
+bool ThreadPool::takeTask(int index, Task& task) {
+    {
+        WorkerQueue& own = *queues[index];
+        lock_guard<mutex> lock(own.queueMutex);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedCount--;
+            return true;
+        }
+    }
+
+    size_t count = queues.size();
+    for (size_t offset = 1; offset < count; offset++) {
+        WorkerQueue& victim = *queues[(index + offset) % count];
+        lock_guard<mutex> lock(victim.queueMutex);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedCount--;
+            stealCount++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int index) {
+    workerIndex = index;
+
+    while (true) {
+        releaseDueTimers(index);
+
+        Task task;
+        if (takeTask(index, task)) {
+            task();
+            if (--unfinishedCount == 0) {
+                lock_guard<mutex> lock(idleMutex);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        // Holding idleMutex across nextTimer() and the wait means a timer
+        // submitted in between still wakes this worker
+        unique_lock<mutex> lock(idleMutex);
+        if (stopping && queuedCount.load() == 0) return;
+
+        TimePoint due;
+        unsigned long long generation = timerGeneration;
+        auto ready = [this, generation] {
+            return stopping.load() || queuedCount.load() > 0 || timerGeneration != generation;
+        };
+        if (nextTimer(due)) {
+            workAvailable.wait_until(lock, due, ready);
+        } else {
+            workAvailable.wait(lock, ready);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+/*
+* ----------------------------------------------------------------------------
+ *  ThreadPool Header - Persistent Work-Stealing Worker Pool
+ * ----------------------------------------------------------------------------
+ *  This header defines the ThreadPool class, a fixed set of worker threads
+ *  that replaces spawning a new detached thread for every site. Each worker
+ *  owns a double-ended task queue:
+ *  - Tasks submitted from a worker go to the back of its own deque and are
+ *    taken back LIFO, which keeps a site's follow-up work on a warm thread.
+ *  - Idle workers steal from the front of other workers' deques (FIFO), so
+ *    the oldest, typically largest, pieces of work are redistributed.
+ *  - Every deque has its own lock, so there is no single global queue lock.
+ *  - Tasks can be scheduled for a later time. They wait in a min-heap keyed
+ *    by due time and move onto a worker's deque once due, so a worker never
+ *    sleeps while another host has work ready.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class ThreadPool {
+public:
+    typedef function<void()> Task;
+    typedef chrono::steady_clock::time_point TimePoint;
+
+    explicit ThreadPool(int workers);
+    ~ThreadPool();
+
+    // Queues a task. From a worker thread it goes to that worker's own deque;
+    // from any other thread the deques are filled round-robin.
+    void submit(Task task);
+
+    // Queues a task that must not start before due
+    void submitAt(TimePoint due, Task task);
+
+    // Blocks until every submitted task (including tasks they submitted) ran
+    void waitIdle();
+
+    // Number of tasks that were executed by a worker other than their owner
+    size_t steals() const { return stealCount.load(); }
+
+    // Index of the calling worker thread, or -1 when called from outside
+    static int currentWorker();
+
+private:
+    struct WorkerQueue {
+        mutex queueMutex;
+        deque<Task> tasks;
+    };
+
+    struct TimedTask {
+        TimePoint due;
+        unsigned long long sequence;     // Keeps equal due times in FIFO order
+        Task task;
+        bool operator>(const TimedTask& other) const {
+            return due != other.due ? due > other.due : sequence > other.sequence;
+        }
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues;
+    vector<thread> workers;
+    atomic<size_t> queuedCount;      // Tasks sitting in any deque
+    atomic<size_t> unfinishedCount;  // Tasks queued or currently running
+    atomic<size_t> stealCount;
+    atomic<size_t> nextQueue;        // Round-robin cursor for external submits
+    atomic<bool> stopping;
+
+    mutex timerMutex;                // Guards timers and timerSequence
+    vector<TimedTask> timers;        // Min-heap of delayed tasks
+    unsigned long long timerSequence;
+
+    mutex idleMutex;
+    unsigned long long timerGeneration;  // Bumped by submitAt (idleMutex)
+    condition_variable workAvailable;
+    condition_variable allDone;
+
+    void workerLoop(int index);
+    bool takeTask(int index, Task& task);
+    void releaseDueTimers(int index);
+    bool nextTimer(TimePoint& due);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+};
+
+#endif
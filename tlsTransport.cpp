@@ -0,0 +1,258 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  TlsTransport Implementation
+ * ----------------------------------------------------------------------------
+ *  Sessions are captured through OpenSSL's new-session callback, which also
+ *  sees the tickets TLS 1.3 servers send after the handshake. Each host keeps
+ *  only its latest session; once maxSessions hosts are cached, an arbitrary
+ *  one is dropped, since sites are crawled one after another and old sessions
+ *  are rarely needed again.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "tlsTransport.h"
+#include <stdexcept>
+
+#ifdef WEBREAPER_TLS
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#endif
+
+TlsContext& TlsContext::shared() {
+    static TlsContext instance;
+    return instance;
+}
+
+bool TlsContext::available() {
+#ifdef WEBREAPER_TLS
+    return true;
+#else
+    return false;
+#endif
+}
+
+TlsContext::TlsContext() : context(nullptr), verify(false), fullCount(0), resumedCount(0) {}
+
+TlsContext::~TlsContext() {
+#ifdef WEBREAPER_TLS
+    for (auto& entry : sessions) SSL_SESSION_free(entry.second);
+    if (context) SSL_CTX_free(context);
+#endif
+}
+
+void TlsContext::configure(bool verifyPeers, const string& caFile) {
+#ifdef WEBREAPER_TLS
+    if (context) return;
+
+    SSL_CTX* created = SSL_CTX_new(TLS_client_method());
+    if (!created) throw runtime_error("Cannot create TLS context");
+    SSL_CTX_set_min_proto_version(created, TLS1_2_VERSION);
+    // send() semantics: partial writes, retried from wherever the request is
+    SSL_CTX_set_mode(created, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    // HTTP framing, not close_notify, tells complete responses from cut ones
+    SSL_CTX_set_options(created, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+
+    if (verifyPeers) {
+        bool loaded = caFile.empty() ? SSL_CTX_set_default_verify_paths(created) == 1
+                                     : SSL_CTX_load_verify_locations(created, caFile.c_str(), nullptr) == 1;
+        if (!loaded) {
+            SSL_CTX_free(created);
+            throw runtime_error("Cannot load TLS certificates" + (caFile.empty() ? string() : " from " + caFile));
+        }
+        SSL_CTX_set_verify(created, SSL_VERIFY_PEER, nullptr);
+    }
+
+    // The client side cache is ours; OpenSSL only reports new sessions
+    SSL_CTX_set_session_cache_mode(created, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(created, &TlsContext::onNewSession);
+
+    verify = verifyPeers;
+    context = created;
+#else
+    (void)verifyPeers;
+    (void)caFile;
+#endif
+}
+
+void TlsContext::markSecure(string_view host) {
+    lock_guard<mutex> lock(hostMutex);
+    secureHosts.insertUrl(host);
+}
+
+bool TlsContext::isSecure(string_view host) const {
+    lock_guard<mutex> lock(hostMutex);
+    return secureHosts.containsUrl(host);
+}
+
+void TlsContext::applySession(ssl_st* ssl, const string& host) {
+#ifdef WEBREAPER_TLS
+    lock_guard<mutex> lock(sessionMutex);
+    auto it = sessions.find(host);
+    if (it != sessions.end()) SSL_set_session(ssl, it->second);
+#else
+    (void)ssl;
+    (void)host;
+#endif
+}
+
+void TlsContext::storeSession(const string& host, ssl_session_st* session) {
+#ifdef WEBREAPER_TLS
+    lock_guard<mutex> lock(sessionMutex);
+    auto it = sessions.find(host);
+    if (it != sessions.end()) {
+        SSL_SESSION_free(it->second);
+        it->second = session;
+        return;
+    }
+    if (sessions.size() >= maxSessions) {
+        SSL_SESSION_free(sessions.begin()->second);
+        sessions.erase(sessions.begin());
+    }
+    sessions.emplace(host, session);
+#else
+    (void)host;
+    (void)session;
+#endif
+}
+
+// Returning 1 keeps the reference OpenSSL hands over
+int TlsContext::onNewSession(ssl_st* ssl, ssl_session_st* session) {
+#ifdef WEBREAPER_TLS
+    TlsStream* stream = static_cast<TlsStream*>(SSL_get_app_data(ssl));
+    if (!stream) return 0;
+    TlsContext::shared().storeSession(stream->host, session);
+    return 1;
+#else
+    (void)ssl;
+    (void)session;
+    return 0;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// TlsStream
+// ----------------------------------------------------------------------------
+TlsStream::TlsStream() : ssl(nullptr) {}
+
+TlsStream::~TlsStream() {
+    close();
+}
+
+bool TlsStream::begin(SOCKET sock, const string& hostname) {
+#ifdef WEBREAPER_TLS
+    close();
+    TlsContext& tls = TlsContext::shared();
+    if (!tls.enabled()) return false;
+
+    ssl = SSL_new(tls.context);
+    if (!ssl) return false;
+    host = hostname;
+
+    static const unsigned char alpn[] = {8, 'h', 't', 't', 'p', '/', '1', '.', '1'};
+    SSL_set_app_data(ssl, this);
+    SSL_set_connect_state(ssl);
+    bool ready = SSL_set_fd(ssl, (int)sock) == 1 &&
+                 SSL_set_tlsext_host_name(ssl, host.c_str()) == 1 &&
+                 SSL_set_alpn_protos(ssl, alpn, sizeof(alpn)) == 0 &&
+                 (!tls.verify || SSL_set1_host(ssl, host.c_str()) == 1);
+    if (!ready) {
+        close();
+        return false;
+    }
+
+    tls.applySession(ssl, host);
+    return true;
+#else
+    (void)sock;
+    (void)hostname;
+    return false;
+#endif
+}
+
+TlsStream::Status TlsStream::status(int result) {
+#ifdef WEBREAPER_TLS
+    switch (SSL_get_error(ssl, result)) {
+    case SSL_ERROR_WANT_READ:
+        return Status::WantRead;
+    case SSL_ERROR_WANT_WRITE:
+        return Status::WantWrite;
+    case SSL_ERROR_ZERO_RETURN:
+        return Status::Closed;
+    case SSL_ERROR_SYSCALL:
+        // A reset or EOF on the socket, as a plain recv() would report it
+        return Status::Closed;
+    default:
+        return Status::Error;
+    }
+#else
+    (void)result;
+    return Status::Error;
+#endif
+}
+
+TlsStream::Status TlsStream::handshake() {
+#ifdef WEBREAPER_TLS
+    if (!ssl) return Status::Error;
+    ERR_clear_error();
+    int result = SSL_do_handshake(ssl);
+    if (result != 1) {
+        Status blocked = status(result);
+        return blocked == Status::Closed ? Status::Error : blocked;
+    }
+
+    TlsContext& tls = TlsContext::shared();
+    if (SSL_session_reused(ssl)) tls.resumedCount++;
+    else tls.fullCount++;
+    return Status::Ok;
+#else
+    return Status::Error;
+#endif
+}
+
+TlsStream::Status TlsStream::read(char* buffer, int length, int& bytesRead) {
+    bytesRead = 0;
+#ifdef WEBREAPER_TLS
+    if (!ssl) return Status::Error;
+    ERR_clear_error();
+    int result = SSL_read(ssl, buffer, length);
+    if (result > 0) {
+        bytesRead = result;
+        return Status::Ok;
+    }
+    return status(result);
+#else
+    (void)buffer;
+    (void)length;
+    return Status::Error;
+#endif
+}
+
+TlsStream::Status TlsStream::write(const char* data, int length, int& bytesWritten) {
+    bytesWritten = 0;
+#ifdef WEBREAPER_TLS
+    if (!ssl) return Status::Error;
+    ERR_clear_error();
+    int result = SSL_write(ssl, data, length);
+    if (result > 0) {
+        bytesWritten = result;
+        return Status::Ok;
+    }
+    return status(result);
+#else
+    (void)data;
+    (void)length;
+    return Status::Error;
+#endif
+}
+
+void TlsStream::close() {
+#ifdef WEBREAPER_TLS
+    if (!ssl) return;
+    ERR_clear_error();
+    if (SSL_is_init_finished(ssl)) SSL_shutdown(ssl);
+    SSL_free(ssl);
+#endif
+    ssl = nullptr;
+}
@@ -0,0 +1,123 @@
+/*
+* ----------------------------------------------------------------------------
+ *  TlsTransport Header - HTTPS over Non-Blocking Sockets
+ * ----------------------------------------------------------------------------
+ *  This header defines the TLS layer used by HostConnection for HTTPS
+ *  sites. TlsContext holds the process-wide OpenSSL context, the client
+ *  session cache and the set of hosts known to serve HTTPS; TlsStream runs
+ *  one TLS connection over a non-blocking socket, reporting which way it is
+ *  blocked so the existing state machines can wait on the socket.
+ *
+ *  Key Features:
+ *  - SNI, ALPN (http/1.1) and optional certificate and hostname checks.
+ *  - Session tickets cached per host, so reconnections to a host resume
+ *    instead of running a full handshake.
+ *  - Handshake, read and write never block.
+ *  - Compiled in with WEBREAPER_TLS; otherwise TlsContext is never enabled
+ *    and sites are crawled over plain HTTP.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef TLSTRANSPORT_H
+#define TLSTRANSPORT_H
+
+#include "netPlatform.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include "urlSet.h"
+
+using namespace std;
+
+struct ssl_st;
+struct ssl_ctx_st;
+struct ssl_session_st;
+
+class TlsContext {
+public:
+    static TlsContext& shared();
+
+    // True when built with TLS support
+    static bool available();
+
+    // Creates the client context. verifyPeers checks certificates against
+    // caFile, or the system store when caFile is empty. Throws runtime_error
+    // when the context or the CA file cannot be loaded. Without TLS support
+    // this does nothing and enabled() stays false.
+    void configure(bool verifyPeers, const string& caFile);
+    bool enabled() const { return context != nullptr; }
+
+    // Hosts seen with https:// links or redirects; they are crawled over TLS
+    void markSecure(string_view host);
+    bool isSecure(string_view host) const;
+
+    size_t fullHandshakes() const { return fullCount.load(); }
+    size_t resumedHandshakes() const { return resumedCount.load(); }
+
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+private:
+    friend class TlsStream;
+
+    static const size_t maxSessions = 4096;   // Hosts with a cached session
+
+    ssl_ctx_st* context;
+    bool verify;                     // Check certificates and hostnames
+    mutable mutex sessionMutex;      // Guards sessions
+    unordered_map<string, ssl_session_st*> sessions;   // Latest session per host
+    mutable mutex hostMutex;         // Guards secureHosts
+    UrlFingerprintSet secureHosts;   // Fingerprints of hosts that serve HTTPS
+    atomic<size_t> fullCount;        // Handshakes that negotiated a new session
+    atomic<size_t> resumedCount;     // Handshakes that resumed a cached session
+
+    TlsContext();
+    ~TlsContext();
+
+    void applySession(ssl_st* ssl, const string& host);
+    void storeSession(const string& host, ssl_session_st* session);
+    static int onNewSession(ssl_st* ssl, ssl_session_st* session);
+};
+
+// One TLS connection over a connected non-blocking socket
+class TlsStream {
+public:
+    enum class Status {
+        Ok,         // Progress was made (or the handshake is complete)
+        WantRead,   // Blocked until the socket is readable
+        WantWrite,  // Blocked until the socket is writable
+        Closed,     // The peer closed the connection
+        Error       // Handshake, certificate or protocol failure
+    };
+
+    TlsStream();
+    ~TlsStream();
+
+    // Attaches to sock and prepares the handshake for host
+    bool begin(SOCKET sock, const string& host);
+
+    Status handshake();
+    Status read(char* buffer, int length, int& bytesRead);
+    Status write(const char* data, int length, int& bytesWritten);
+
+    // Sends close_notify (without waiting for the reply) and releases the
+    // connection; the socket itself is left to the caller
+    void close();
+
+    bool active() const { return ssl != nullptr; }
+
+    TlsStream(const TlsStream&) = delete;
+    TlsStream& operator=(const TlsStream&) = delete;
+
+private:
+    ssl_st* ssl;
+    string host;                     // Session cache key
+
+    Status status(int result);
+
+    friend class TlsContext;
+};
+
+#endif
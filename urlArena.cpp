@@ -0,0 +1,78 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  UrlArena Implementation
+ * ----------------------------------------------------------------------------
+ *  Strings are bump-allocated from the last chunk. A string that does not
+ *  fit starts a new chunk; one longer than a chunk gets a chunk of its own
+ *  size, so no string ever spans two chunks.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "urlArena.h"
+#include <algorithm>
+#include <cstring>
+
+const size_t UrlArena::chunkSize;   // Bound to references by max()
+
+ArenaString UrlArena::store(string_view text) {
+    size_t length = text.size();
+    if (chunks.empty() || chunks.back().size() - used < length) {
+        chunks.push_back(vector<char>(max(chunkSize, length)));
+        used = 0;
+    }
+
+    ArenaString ref;
+    ref.chunk = (uint32_t)(chunks.size() - 1);
+    ref.offset = (uint32_t)used;
+    ref.length = (uint32_t)length;
+    if (length) memcpy(chunks.back().data() + used, text.data(), length);
+    used += length;
+    return ref;
+}
+
+void UrlArena::clear() {
+    if (!chunks.empty() && chunks.front().size() == chunkSize) chunks.resize(1);
+    else chunks.clear();
+    used = 0;
+}
+
+size_t UrlArena::memoryBytes() const {
+    size_t total = 0;
+    for (const auto& chunk : chunks) total += chunk.size();
+    return total;
+}
+
+// ----------------------------------------------------------------------------
+// UrlList
+// ----------------------------------------------------------------------------
+void UrlList::add(string_view host, string_view path, int depth, double responseTime) {
+    UrlRecord record;
+
+    // Lists tend to hold runs of the same host; store it once per run
+    if (!records.empty() && arena.equals(records.back().host, host)) record.host = records.back().host;
+    else record.host = arena.store(host);
+
+    record.path = arena.store(path);
+    record.depth = depth;
+    record.responseTime = (float)responseTime;
+    records.push_back(record);
+}
+
+string UrlList::url(const UrlRecord& record) const {
+    string result;
+    result.reserve(record.host.length + record.path.length);
+    result.append(host(record));
+    result.append(path(record));
+    return result;
+}
+
+void UrlList::clear() {
+    records.clear();
+    arena.clear();
+    head = 0;
+}
+
+void UrlList::pop() {
+    if (empty()) return;
+    if (++head == records.size()) clear();
+}
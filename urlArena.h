@@ -0,0 +1,116 @@
+/*
+* ----------------------------------------------------------------------------
+ *  UrlArena Header - Chunked String Arena and Compact URL Records
+ * ----------------------------------------------------------------------------
+ *  This header defines the storage used for the crawler's URL collections
+ *  (frontiers, extracted links, visited pages). Instead of one heap node and
+ *  two std::strings per URL, the characters of all URLs of a collection are
+ *  packed into large arena chunks and every URL is a small fixed-size record
+ *  that refers to them by offset.
+ *
+ *  Key Features:
+ *  - UrlArena: append-only character storage in 64 KB chunks; strings are
+ *    never moved, and the whole arena is freed (or recycled) at once.
+ *  - UrlRecord: host and path as arena offsets, with typed depth and
+ *    response time fields instead of string metadata.
+ *  - UrlList: FIFO list of records over its own arena. Consecutive records
+ *    of the same host share one stored copy of the hostname, and popped
+ *    records are reclaimed in bulk once the list drains.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef URLARENA_H
+#define URLARENA_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Reference to a string stored in a UrlArena
+struct ArenaString {
+    uint32_t chunk;                  // Index of the chunk holding the characters
+    uint32_t offset;                 // Position of the first character in that chunk
+    uint32_t length;                 // Number of characters
+};
+
+// ----------------------------------------------------------------------------
+// UrlArena: append-only string storage
+// ----------------------------------------------------------------------------
+class UrlArena {
+public:
+    static const size_t chunkSize = 64 * 1024;
+
+    UrlArena() : used(0) {}
+
+    // Copies text into the arena; the reference stays valid until clear()
+    ArenaString store(string_view text);
+
+    const char* data(ArenaString ref) const { return chunks[ref.chunk].data() + ref.offset; }
+    string_view view(ArenaString ref) const { return string_view(data(ref), ref.length); }
+    bool equals(ArenaString ref, string_view text) const { return view(ref) == text; }
+
+    // Drops every string; the first chunk is kept for reuse
+    void clear();
+
+    size_t chunkCount() const { return chunks.size(); }
+    size_t memoryBytes() const;
+
+private:
+    vector<vector<char>> chunks;     // Each chunk is allocated once at full size
+    size_t used;                     // Bytes used in the last chunk
+};
+
+// Compact record for one URL (or site, when path is empty)
+struct UrlRecord {
+    ArenaString host;                // Hostname; empty for links relative to the page's host
+    ArenaString path;                // Path starting with "/", or empty for a whole site
+    int32_t depth;                   // Distance from the start sites
+    float responseTime;              // Time to first byte in ms, for visited pages
+};
+
+// ----------------------------------------------------------------------------
+// UrlList: FIFO list of UrlRecords backed by one arena
+// ----------------------------------------------------------------------------
+class UrlList {
+public:
+    typedef vector<UrlRecord>::const_iterator const_iterator;
+
+    UrlList() : head(0) {}
+
+    // Appends a record; host and path are copied into the arena
+    void add(string_view host, string_view path, int depth = 0, double responseTime = 0);
+
+    // Frees all records and strings at once
+    void clear();
+
+    bool empty() const { return head == records.size(); }
+    size_t size() const { return records.size() - head; }
+
+    // Oldest record still in the list, and its removal. Storage of popped
+    // records is reclaimed when the list becomes empty.
+    const UrlRecord& front() const { return records[head]; }
+    void pop();
+
+    // Iterates over the records still in the list, oldest first
+    const_iterator begin() const { return records.begin() + head; }
+    const_iterator end() const { return records.end(); }
+
+    // Views into the arena; valid until the record is popped or cleared
+    string_view host(const UrlRecord& record) const { return arena.view(record.host); }
+    string_view path(const UrlRecord& record) const { return arena.view(record.path); }
+    string url(const UrlRecord& record) const;
+    bool hostEquals(const UrlRecord& record, string_view text) const { return arena.equals(record.host, text); }
+
+    size_t memoryBytes() const { return arena.memoryBytes() + records.capacity() * sizeof(UrlRecord); }
+
+private:
+    UrlArena arena;
+    vector<UrlRecord> records;
+    size_t head;                     // Index of the first record not yet popped
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  UrlFilter Implementation
+ * ----------------------------------------------------------------------------
+ *  Every entry is stored with a leading dot (".pk", ".tar.gz"), so a plain
+ *  suffix match is already anchored at a label or extension boundary. The
+ *  tries are walked from the last character backwards and stop at the first
+ *  complete entry, or as soon as no entry continues with the next character.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "urlFilter.h"
+#include "parser.h"
+#include <algorithm>
+
+namespace {
+
+char lower(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? (char)(ch - 'A' + 'a') : ch;
+}
+
+// "pk", ".pk" and "PK" all become ".pk"; blank entries stay empty
+string normalizeEntry(string_view entry) {
+    size_t start = entry.find_first_not_of('.');
+    if (start == string_view::npos) return string();
+    string normalized(1, '.');
+    for (char ch : entry.substr(start)) normalized += lower(ch);
+    return normalized;
+}
+
+}
+
+// ----------------------------------------------------------------------------
+// SuffixTrie
+// ----------------------------------------------------------------------------
+SuffixTrie::SuffixTrie() : nodes(1), count(0) {}
+
+void SuffixTrie::clear() {
+    nodes.assign(1, TrieNode());
+    count = 0;
+}
+
+int32_t SuffixTrie::child(uint32_t node, char label) const {
+    for (const Edge& edge : nodes[node].edges) {
+        if (edge.label == label) return (int32_t)edge.child;
+        if (edge.label > label) break;
+    }
+    return -1;
+}
+
+void SuffixTrie::insert(string_view suffix) {
+    if (suffix.empty()) return;
+
+    uint32_t node = 0;
+    for (size_t i = suffix.size(); i-- > 0;) {
+        char label = lower(suffix[i]);
+        int32_t next = child(node, label);
+        if (next < 0) {
+            next = (int32_t)nodes.size();
+            nodes.emplace_back();
+            vector<Edge>& edges = nodes[node].edges;
+            Edge edge = {label, (uint32_t)next};
+            edges.insert(upper_bound(edges.begin(), edges.end(), edge,
+                                     [](const Edge& a, const Edge& b) { return a.label < b.label; }),
+                         edge);
+        }
+        node = (uint32_t)next;
+    }
+
+    if (!nodes[node].terminal) count++;
+    nodes[node].terminal = true;
+}
+
+bool SuffixTrie::matches(string_view text) const {
+    uint32_t node = 0;
+    for (size_t i = text.size(); i-- > 0;) {
+        int32_t next = child(node, lower(text[i]));
+        if (next < 0) return false;
+        node = (uint32_t)next;
+        if (nodes[node].terminal) return true;
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// UrlFilter
+// ----------------------------------------------------------------------------
+UrlFilter& UrlFilter::shared() {
+    static UrlFilter filter;
+    return filter;
+}
+
+vector<string> UrlFilter::defaultDomains() {
+    return {"com", "pk", "edu", "net", "co", "org", "me"};
+}
+
+vector<string> UrlFilter::defaultTypes() {
+    return {"css", "js", "pdf", "png", "jpeg", "jpg", "ico"};
+}
+
+UrlFilter::UrlFilter() {
+    configure(defaultDomains(), defaultTypes());
+}
+
+void UrlFilter::configure(const vector<string>& allowedDomains, const vector<string>& blockedTypes) {
+    domains.clear();
+    types.clear();
+    for (const string& domain : allowedDomains) domains.insert(normalizeEntry(domain));
+    for (const string& type : blockedTypes) types.insert(normalizeEntry(type));
+}
+
+bool UrlFilter::allowsDomain(string_view hostname) const {
+    return domains.empty() || domains.matches(hostname);
+}
+
+// Only the final path segment can carry an extension: "/img.png/view" is
+// not an image, and neither is the host of "example.co"
+bool UrlFilter::blocksType(string_view url) const {
+    if (types.empty()) return false;
+
+    string_view path = (!url.empty() && url[0] == '/') ? url : getHostPathFromUrl(url);
+    path = path.substr(0, path.find_first_of("?#"));
+    string_view segment = path.substr(path.rfind('/') + 1);
+    return types.matches(segment);
+}
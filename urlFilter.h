@@ -0,0 +1,94 @@
+/*
+* ----------------------------------------------------------------------------
+ *  UrlFilter Header - Domain and File Type Filters
+ * ----------------------------------------------------------------------------
+ *  This header defines the filters behind verifyDomain() and verifyType():
+ *  the allowed domain suffixes (TLDs such as "pk" or "edu.pk") and the
+ *  blocked file extensions (such as "css" or "tar.gz"). Both lists come from
+ *  the configuration and are compiled into suffix tries, walked from the end
+ *  of the hostname or path, so a check costs the length of the URL however
+ *  long the lists are.
+ *
+ *  Key Features:
+ *  - Matches are anchored: a domain suffix must start a label ("shop.pk"
+ *    matches "pk", "shoppk" does not) and an extension must follow the last
+ *    dot of the path's final segment ("/jsonapi" is not a "js" file).
+ *  - Case-insensitive; queries and fragments are ignored for extensions.
+ *  - Defaults reproduce the built-in lists; an empty domain list allows
+ *    every domain.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef URLFILTER_H
+#define URLFILTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Set of strings matched backwards from the end of a text, one node per
+// character. Children are kept in small sorted edge lists, which the
+// restricted URL alphabet keeps short.
+class SuffixTrie {
+public:
+    SuffixTrie();
+
+    // Adds a suffix (lowercased); empty suffixes are ignored
+    void insert(string_view suffix);
+    void clear();
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    // True when text ends with one of the inserted suffixes; text is
+    // compared case-insensitively
+    bool matches(string_view text) const;
+
+private:
+    struct Edge {
+        char label;
+        uint32_t child;
+    };
+
+    struct TrieNode {
+        vector<Edge> edges;          // Sorted by label
+        bool terminal = false;       // An inserted suffix ends here
+    };
+
+    vector<TrieNode> nodes;          // nodes[0] is the root (end of text)
+    size_t count;
+
+    int32_t child(uint32_t node, char label) const;
+};
+
+class UrlFilter {
+public:
+    static UrlFilter& shared();
+
+    static vector<string> defaultDomains();
+    static vector<string> defaultTypes();
+
+    // Replaces both lists. Leading dots are optional ("pk" and ".pk" are the
+    // same). Must be called before crawling starts: lookups take no lock.
+    void configure(const vector<string>& allowedDomains, const vector<string>& blockedTypes);
+
+    // hostname ends with an allowed domain suffix (or no list is set)
+    bool allowsDomain(string_view hostname) const;
+
+    // The URL or path names a file with a blocked extension
+    bool blocksType(string_view url) const;
+
+    UrlFilter(const UrlFilter&) = delete;
+    UrlFilter& operator=(const UrlFilter&) = delete;
+
+private:
+    SuffixTrie domains;
+    SuffixTrie types;
+
+    UrlFilter();
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * ----------------------------------------------------------------------------
+ *  UrlSet Implementation
+ * ----------------------------------------------------------------------------
+ *  Canonicalization works on the URL forms produced by the link extractor
+ *  (with or without scheme, host optional). The fingerprint table keeps its
+ *  load factor at or below three quarters so probe sequences stay short.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "urlSet.h"
+#include <cctype>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Final avalanche step of splitmix64, spreads FNV's weak low bits
+uint64_t mix64(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+size_t roundUpPowerOfTwo(size_t value) {
+    size_t result = 16;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+}
+
+uint64_t fingerprint64(string_view text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char ch : text) {
+        hash ^= ch;
+        hash *= 0x100000001b3ULL;
+    }
+    hash = mix64(hash);
+    return hash == 0 ? 1 : hash;
+}
+
+// RFC 3986 "remove dot segments" on the path part
+string canonicalizePath(string_view path) {
+    vector<pair<size_t, size_t>> segments;   // (offset, length) into path
+    bool directory = path.empty() || path.back() == '/';
+    size_t pos = 0;
+
+    while (pos <= path.size()) {
+        size_t next = path.find('/', pos);
+        if (next == string::npos) next = path.size();
+        size_t length = next - pos;
+
+        if (length == 2 && path.compare(pos, 2, "..") == 0) {
+            if (!segments.empty()) segments.pop_back();
+            if (next == path.size()) directory = true;
+        } else if (length == 1 && path[pos] == '.') {
+            if (next == path.size()) directory = true;
+        } else if (length > 0) {
+            segments.push_back(make_pair(pos, length));
+        }
+        pos = next + 1;
+    }
+
+    string result;
+    result.reserve(path.size() + 1);
+    for (const auto& segment : segments) {
+        result += '/';
+        result.append(path, segment.first, segment.second);
+    }
+    if (result.empty() || directory) result += '/';
+    return result;
+}
+
+string canonicalizeUrl(string_view url) {
+    // Fragment never reaches the server
+    size_t end = url.find('#');
+    if (end == string::npos) end = url.size();
+
+    // Scheme (defaults to http, which is all the crawler speaks)
+    string scheme = "http";
+    size_t pos = 0;
+    size_t schemeEnd = url.find("://");
+    if (schemeEnd != string::npos && schemeEnd < end) {
+        scheme.clear();
+        for (size_t i = 0; i < schemeEnd; i++) scheme += (char)tolower((unsigned char)url[i]);
+        pos = schemeEnd + 3;
+    }
+
+    // Authority: lowercase host, default port dropped
+    size_t authorityEnd = url.find_first_of("/?", pos);
+    if (authorityEnd == string::npos || authorityEnd > end) authorityEnd = end;
+    string host;
+    for (size_t i = pos; i < authorityEnd; i++) host += (char)tolower((unsigned char)url[i]);
+
+    size_t colon = host.rfind(':');
+    if (colon != string::npos) {
+        string port = host.substr(colon + 1);
+        if (port.empty() || (scheme == "http" && port == "80") || (scheme == "https" && port == "443")) {
+            host.erase(colon);
+        }
+    }
+
+    // Path and query
+    size_t queryStart = url.find('?', authorityEnd);
+    if (queryStart == string::npos || queryStart > end) queryStart = end;
+    string path = canonicalizePath(url.substr(authorityEnd, queryStart - authorityEnd));
+    string_view query = url.substr(queryStart, end - queryStart);
+    if (query == "?") query = string_view();
+
+    string result = scheme + "://" + host + path;
+    result.append(query.data(), query.size());
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// UrlFingerprintSet
+// ----------------------------------------------------------------------------
+UrlFingerprintSet::UrlFingerprintSet(size_t expectedSize)
+    : slots(roundUpPowerOfTwo(expectedSize * 4 / 3 + 1), 0), count(0) {
+    mask = slots.size() - 1;
+}
+
+bool UrlFingerprintSet::insert(uint64_t fingerprint) {
+    if (fingerprint == 0) fingerprint = 1;
+    if ((count + 1) * 4 > slots.size() * 3) grow();
+
+    size_t index = (size_t)fingerprint & mask;
+    while (slots[index] != 0) {
+        if (slots[index] == fingerprint) return false;
+        index = (index + 1) & mask;
+    }
+    slots[index] = fingerprint;
+    count++;
+    return true;
+}
+
+bool UrlFingerprintSet::contains(uint64_t fingerprint) const {
+    if (fingerprint == 0) fingerprint = 1;
+
+    size_t index = (size_t)fingerprint & mask;
+    while (slots[index] != 0) {
+        if (slots[index] == fingerprint) return true;
+        index = (index + 1) & mask;
+    }
+    return false;
+}
+
+void UrlFingerprintSet::clear() {
+    fill(slots.begin(), slots.end(), 0);
+    count = 0;
+}
+
+void UrlFingerprintSet::grow() {
+    vector<uint64_t> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, 0);
+    mask = slots.size() - 1;
+
+    for (uint64_t fingerprint : old) {
+        if (fingerprint == 0) continue;
+        size_t index = (size_t)fingerprint & mask;
+        while (slots[index] != 0) index = (index + 1) & mask;
+        slots[index] = fingerprint;
+    }
+}
@@ -0,0 +1,73 @@
+/*
+* ----------------------------------------------------------------------------
+ *  UrlSet Header - URL Canonicalization and Fingerprint Deduplication
+ * ----------------------------------------------------------------------------
+ *  This header defines the deduplication subsystem used for discovered pages
+ *  and sites. Instead of storing every URL as a string in an ordered map,
+ *  URLs are canonicalized, hashed to a 64-bit fingerprint, and kept in an
+ *  open-addressing hash table that stores nothing but the fingerprints.
+ *
+ *  Key Features:
+ *  - Canonicalization: lowercase scheme and host, default port removed,
+ *    "." and ".." path segments resolved, fragment dropped.
+ *  - 64-bit fingerprints (FNV-1a with a final avalanche mix).
+ *  - Linear probing over a flat power-of-two array: 8 bytes per slot,
+ *    O(1) lookups with one cache line touched in the common case.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef URLSET_H
+#define URLSET_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Returns the canonical form of a URL or host/path reference, e.g.
+// "HTTP://Example.COM:80/a/./b/../c#top" -> "http://example.com/a/c"
+string canonicalizeUrl(string_view url);
+
+// Resolves "." and ".." segments of a path; the result always starts with "/"
+string canonicalizePath(string_view path);
+
+// 64-bit hash of arbitrary bytes (never 0)
+uint64_t fingerprint64(string_view text);
+
+// Fingerprint of the canonical form of a URL
+inline uint64_t urlFingerprint(string_view url) { return fingerprint64(canonicalizeUrl(url)); }
+
+// ----------------------------------------------------------------------------
+// UrlFingerprintSet: open-addressing set of 64-bit fingerprints
+// ----------------------------------------------------------------------------
+// Not thread-safe; callers guard it with the lock of the owning structure.
+class UrlFingerprintSet {
+public:
+    explicit UrlFingerprintSet(size_t expectedSize = 64);
+
+    // Adds a fingerprint; returns true if it was not present before
+    bool insert(uint64_t fingerprint);
+
+    // Checks membership without inserting
+    bool contains(uint64_t fingerprint) const;
+
+    // Convenience wrappers that fingerprint the canonical URL first
+    bool insertUrl(string_view url) { return insert(urlFingerprint(url)); }
+    bool containsUrl(string_view url) const { return contains(urlFingerprint(url)); }
+
+    void clear();
+    size_t size() const { return count; }
+    size_t memoryBytes() const { return slots.size() * sizeof(uint64_t); }
+
+private:
+    vector<uint64_t> slots;          // 0 marks an empty slot
+    size_t count;                    // Number of stored fingerprints
+    size_t mask;                     // slots.size() - 1
+
+    void grow();
+};
+
+#endif